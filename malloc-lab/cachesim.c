@@ -0,0 +1,231 @@
+/*
+ * cachesim.c - a set-associative L1/L2/TLB model for the allocator's
+ *     metadata accesses.
+ *
+ * mm.c built with -DMM_CACHESIM passes the address of every header/footer
+ * GET/PUT and free-list pointer load/store to cachesim_access. Each access
+ * is looked up in an L1 data cache, on a miss in an L2 cache, and in a
+ * data TLB, all with LRU replacement. The geometry is set in config.h.
+ * Software prefetches (cachesim_prefetch) fill the same structures but are
+ * counted on their own, so a prefetch that hides a later miss shows up as
+ * one prefetch instead of one miss.
+ *
+ * Heap addresses are simulated as offsets from the start of the memlib
+ * heap, and addresses in a large object mapping as offsets from a base
+ * chosen by its memlib slot, so the results do not depend on where the
+ * heap and the mappings were mapped.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cachesim.h"
+#include "memlib.h"
+#include "config.h"
+
+#define L1_SETS (CSIM_L1_SIZE / (CSIM_LINE * CSIM_L1_WAYS))
+#define L2_SETS (CSIM_L2_SIZE / (CSIM_LINE * CSIM_L2_WAYS))
+#define TLB_SETS (CSIM_TLB_ENTRIES / CSIM_TLB_WAYS)
+
+/* simulated addresses of non-heap metadata start here (above any heap) */
+#define STATIC_BASE ((uintptr_t)MAX_HEAP + CSIM_PAGE)
+/* mapping in slot i is simulated at STATIC_BASE + (i + 1) * MAP_STRIDE */
+#define MAP_STRIDE ((uintptr_t)1 << 36)
+
+/* L2 is the largest structure; every level uses arrays of this size */
+#define MAX_ENTRIES (L2_SETS * CSIM_L2_WAYS)
+typedef char csim_l2_is_largest[(L1_SETS * CSIM_L1_WAYS <= MAX_ENTRIES &&
+                                 CSIM_TLB_ENTRIES <= MAX_ENTRIES) ? 1 : -1];
+
+/* One set-associative structure (cache or TLB) with LRU replacement */
+typedef struct
+{
+    int sets;
+    int ways;
+    uintptr_t tags[MAX_ENTRIES];
+    unsigned long used[MAX_ENTRIES];
+    unsigned char valid[MAX_ENTRIES];
+} level_t;
+
+/* Per-function counters */
+typedef struct
+{
+    unsigned long accesses;
+    unsigned long prefetches;
+    unsigned long l1_misses;
+    unsigned long l2_misses;
+    unsigned long tlb_misses;
+} counts_t;
+
+static const char *func_names[CS_NFUNCS] = {
+    "(other)", "mm_malloc", "mm_free", "mm_realloc", "extend_heap",
+    "find_fit", "place", "coalesce", "insert_into_list", "remove_from_list",
+    "large_malloc", "large_free", "large_realloc"};
+
+static level_t l1, l2, tlb;
+static counts_t counts[CS_NFUNCS];
+static unsigned long tick;     /* LRU clock */
+static int enabled;            /* simulate accesses only when set */
+static int current = CS_OTHER; /* function accesses are attributed to */
+static uintptr_t static_page;  /* first non-heap page seen (0: none yet) */
+
+/*
+ * lookup - look up block number blk in lv; returns 1 on a hit. On a miss
+ *     the least recently used way of the set is replaced.
+ */
+static int lookup(level_t *lv, uintptr_t blk)
+{
+    int set = blk % lv->sets;
+    int base = set * lv->ways;
+    int victim = base;
+
+    for (int i = base; i < base + lv->ways; i++)
+    {
+        if (lv->valid[i] && lv->tags[i] == blk)
+        {
+            lv->used[i] = ++tick;
+            return 1;
+        }
+        if (!lv->valid[i] || (lv->valid[victim] && lv->used[i] < lv->used[victim]))
+            victim = i;
+    }
+    lv->valid[victim] = 1;
+    lv->tags[victim] = blk;
+    lv->used[victim] = ++tick;
+    return 0;
+}
+
+/*
+ * sim_addr - map a real address to its deterministic simulated address
+ */
+static uintptr_t sim_addr(const char *p)
+{
+    const char *lo = (const char *)mem_heap_lo();
+    size_t off;
+    int slot;
+
+    if (p >= lo && p < lo + MAX_HEAP)
+        return (uintptr_t)(p - lo);
+
+    /* large object mappings: slots are handed out in a fixed order */
+    if (mem_mapsize() > 0 && (slot = mem_map_slot(p, &off)) >= 0)
+        return STATIC_BASE + (uintptr_t)(slot + 1) * MAP_STRIDE + off;
+
+    /* non-heap metadata (seg_list_roots): keep the offset within the page */
+    if (static_page == 0)
+        static_page = (uintptr_t)p & ~(uintptr_t)(CSIM_PAGE - 1);
+    return STATIC_BASE + ((uintptr_t)p - static_page);
+}
+
+void cachesim_reset(void)
+{
+    memset(&l1, 0, sizeof(l1));
+    memset(&l2, 0, sizeof(l2));
+    memset(&tlb, 0, sizeof(tlb));
+    l1.sets = L1_SETS;
+    l1.ways = CSIM_L1_WAYS;
+    l2.sets = L2_SETS;
+    l2.ways = CSIM_L2_WAYS;
+    tlb.sets = TLB_SETS;
+    tlb.ways = CSIM_TLB_WAYS;
+    memset(counts, 0, sizeof(counts));
+    tick = 0;
+    static_page = 0;
+}
+
+void cachesim_enable(int on)
+{
+    enabled = on;
+}
+
+void *cachesim_access(const void *p, size_t n)
+{
+    uintptr_t first, last;
+    counts_t *c = &counts[current];
+
+    if (!enabled)
+        return (void *)p;
+
+    first = sim_addr(p);
+    last = first + n - 1;
+    c->accesses++;
+
+    /* an access may straddle two lines (or pages) */
+    for (uintptr_t line = first / CSIM_LINE; line <= last / CSIM_LINE; line++)
+    {
+        if (!lookup(&l1, line))
+        {
+            c->l1_misses++;
+            if (!lookup(&l2, line))
+                c->l2_misses++;
+        }
+    }
+    for (uintptr_t page = first / CSIM_PAGE; page <= last / CSIM_PAGE; page++)
+    {
+        if (!lookup(&tlb, page))
+            c->tlb_misses++;
+    }
+    return (void *)p;
+}
+
+void cachesim_prefetch(const void *p, size_t n)
+{
+    uintptr_t first, last;
+
+    if (!enabled)
+        return;
+
+    first = sim_addr(p);
+    last = first + n - 1;
+    counts[current].prefetches++;
+
+    for (uintptr_t line = first / CSIM_LINE; line <= last / CSIM_LINE; line++)
+    {
+        if (!lookup(&l1, line))
+            lookup(&l2, line);
+    }
+    for (uintptr_t page = first / CSIM_PAGE; page <= last / CSIM_PAGE; page++)
+        lookup(&tlb, page);
+}
+
+int cachesim_enter(int func)
+{
+    int saved = current;
+    current = func;
+    return saved;
+}
+
+void cachesim_leave(int *saved)
+{
+    current = *saved;
+}
+
+void cachesim_print(double ops)
+{
+    counts_t total = {0, 0, 0, 0, 0};
+
+    if (ops <= 0)
+        ops = 1;
+
+    printf("%18s%10s%9s%9s%9s%9s%9s%9s\n",
+           "function", "accesses", "acc/op", "pf/op", "L1/op", "L2/op", "TLB/op", "L1 miss%");
+    for (int i = 0; i < CS_NFUNCS; i++)
+    {
+        counts_t *c = &counts[i];
+        if (c->accesses == 0)
+            continue;
+        printf("%18s%10lu%9.2f%9.2f%9.3f%9.3f%9.3f%8.1f%%\n",
+               func_names[i], c->accesses, c->accesses / ops, c->prefetches / ops,
+               c->l1_misses / ops, c->l2_misses / ops, c->tlb_misses / ops,
+               100.0 * c->l1_misses / c->accesses);
+        total.accesses += c->accesses;
+        total.prefetches += c->prefetches;
+        total.l1_misses += c->l1_misses;
+        total.l2_misses += c->l2_misses;
+        total.tlb_misses += c->tlb_misses;
+    }
+    printf("%18s%10lu%9.2f%9.2f%9.3f%9.3f%9.3f%8.1f%%\n",
+           "total", total.accesses, total.accesses / ops, total.prefetches / ops,
+           total.l1_misses / ops, total.l2_misses / ops, total.tlb_misses / ops,
+           total.accesses ? 100.0 * total.l1_misses / total.accesses : 0.0);
+}
@@ -0,0 +1,54 @@
+/*
+ * cachesim.h - a set-associative L1/L2/TLB model for the allocator's
+ *     metadata accesses. Only used by the instrumented build
+ *     (make mdriver-cachesim), where mm.c is compiled with -DMM_CACHESIM.
+ */
+#ifndef __CACHESIM_H_
+#define __CACHESIM_H_
+
+#include <stddef.h>
+
+/* Allocator functions that accesses are attributed to (innermost wins) */
+enum
+{
+    CS_OTHER,
+    CS_MM_MALLOC,
+    CS_MM_FREE,
+    CS_MM_REALLOC,
+    CS_EXTEND_HEAP,
+    CS_FIND_FIT,
+    CS_PLACE,
+    CS_COALESCE,
+    CS_INSERT_INTO_LIST,
+    CS_REMOVE_FROM_LIST,
+    CS_LARGE_MALLOC,
+    CS_LARGE_FREE,
+    CS_LARGE_REALLOC,
+    CS_NFUNCS
+};
+
+/* Clear the cache state and all counters (cold caches) */
+void cachesim_reset(void);
+
+/* Accesses are only simulated while enabled (default: disabled) */
+void cachesim_enable(int on);
+
+/* Simulate an n-byte access at p, and return p */
+void *cachesim_access(const void *p, size_t n);
+
+/*
+ * Simulate a software prefetch of n bytes at p: the lines and the page are
+ * filled like an access, but counted as prefetches, not accesses or misses
+ */
+void cachesim_prefetch(const void *p, size_t n);
+
+/* Make func the current function; returns the previous one */
+int cachesim_enter(int func);
+
+/* Restore the function saved by cachesim_enter (used as a cleanup) */
+void cachesim_leave(int *saved);
+
+/* Print accesses, prefetches and misses per op, broken down by function */
+void cachesim_print(double ops);
+
+#endif /* __CACHESIM_H_ */
@@ -0,0 +1,445 @@
+/*
+ * classtune.c - size class table autotuner for mm.c
+ *
+ * Replays the trace suite under many candidate size class tables and
+ * writes the best one as mm_classes.h, which mm.c compiles in.
+ *
+ * Every candidate is scored by running mdriver-tune (mdriver linked with
+ * mm.c built with -DMM_TUNE_CLASSES), which reads the class boundaries
+ * from the MM_CLASSES environment variable. Up to one candidate per core
+ * runs at the same time. The score is the mdriver performance index,
+ * or any other util/throughput weighting given with -w.
+ *
+ * The search starts from the current table, a power-of-two table and a
+ * table with equal numbers of requests per class (taken from the block
+ * sizes the traces request), then hill-climbs: every round perturbs the
+ * best table found so far in several ways and keeps the best result.
+ *
+ * Note that throughput is measured while other candidates run on the
+ * other cores, so it is noisier than a single mdriver run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include "config.h"
+#include "mm_classes.h"
+
+#define MAXLINE 1024    /* max string size */
+#define MAX_CLASSES 32  /* must not exceed MM_TUNE_MAX_CLASSES in mm.c */
+#define MIN_BLOCK 24    /* smallest block mm.c hands out */
+#define MAX_JOBS 256    /* max candidates evaluated at the same time */
+
+/* One candidate class table and its score */
+typedef struct
+{
+    size_t limits[MAX_CLASSES - 1]; /* largest block size of each class */
+    double util;                    /* average utilization */
+    double kops;                    /* throughput in Kops/sec */
+    double score;                   /* objective; < 0 if the run failed */
+} cand_t;
+
+/* Tuning parameters (set from the command line) */
+static int nclasses = MM_NUM_CLASSES;
+static int jobs = 0;
+static int rounds = 20;
+static double util_weight = UTIL_WEIGHT;
+static char tracedir[MAXLINE] = TRACEDIR;
+static char *driver = "./mdriver-tune";
+static char *outfile = "mm_classes.h";
+
+/* Block sizes requested by the traces, sorted, for seeding and mutating */
+static size_t *sizes;
+static int nsizes;
+
+static char *default_tracefiles[] = {
+    DEFAULT_TRACEFILES, NULL};
+
+/*
+ * block_size - the block size mm.c uses for a request of size bytes
+ */
+static size_t block_size(size_t size)
+{
+    if (size <= 2 * 8)
+        return MIN_BLOCK;
+    return (size + 8 + 7) & ~(size_t)7;
+}
+
+static int cmp_size(const void *a, const void *b)
+{
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * read_sizes - collect the block sizes of every malloc/realloc request
+ *     in the default traces
+ */
+static void read_sizes(void)
+{
+    char path[2 * MAXLINE];
+    char type[MAXLINE];
+    int header[4];
+    unsigned index, size;
+    int cap = 1 << 16;
+    FILE *fp;
+
+    if ((sizes = malloc(cap * sizeof(size_t))) == NULL)
+    {
+        perror("malloc");
+        exit(1);
+    }
+    for (int t = 0; default_tracefiles[t] != NULL; t++)
+    {
+        snprintf(path, sizeof(path), "%s%s", tracedir, default_tracefiles[t]);
+        if ((fp = fopen(path, "r")) == NULL)
+        {
+            fprintf(stderr, "classtune: cannot open %s: %s\n", path, strerror(errno));
+            exit(1);
+        }
+        for (int i = 0; i < 4; i++)
+            fscanf(fp, "%d", &header[i]);
+        while (fscanf(fp, "%s", type) != EOF)
+        {
+            if (type[0] == 'f')
+            {
+                fscanf(fp, "%u", &index);
+                continue;
+            }
+            fscanf(fp, "%u %u", &index, &size);
+            if (nsizes == cap)
+            {
+                cap *= 2;
+                if ((sizes = realloc(sizes, cap * sizeof(size_t))) == NULL)
+                {
+                    perror("realloc");
+                    exit(1);
+                }
+            }
+            sizes[nsizes++] = block_size(size);
+        }
+        fclose(fp);
+    }
+    qsort(sizes, nsizes, sizeof(size_t), cmp_size);
+}
+
+/*
+ * fix_table - round every boundary to (multiple of 8) - 1 and make the
+ *     table strictly increasing and at least MIN_BLOCK
+ */
+static void fix_table(size_t *limits)
+{
+    for (int i = 0; i < nclasses - 1; i++)
+    {
+        size_t lo = (i == 0) ? MIN_BLOCK : limits[i - 1] + 8;
+        limits[i] = (limits[i] | 7);
+        if (limits[i] < lo)
+            limits[i] = lo | 7;
+    }
+}
+
+/*
+ * seed_* - the starting candidates
+ */
+static void seed_current(cand_t *c)
+{
+    static const size_t current[] = MM_CLASS_LIMITS;
+    int n = sizeof(current) / sizeof(current[0]);
+
+    for (int i = 0; i < nclasses - 1; i++)
+        c->limits[i] = (i < n) ? current[i] : current[n - 1] << (i - n + 1);
+    fix_table(c->limits);
+}
+
+static void seed_pow2(cand_t *c)
+{
+    for (int i = 0; i < nclasses - 1; i++)
+        c->limits[i] = ((size_t)32 << i) - 1;
+    fix_table(c->limits);
+}
+
+static void seed_quantiles(cand_t *c)
+{
+    for (int i = 0; i < nclasses - 1; i++)
+        c->limits[i] = sizes[(size_t)nsizes * (i + 1) / nclasses];
+    fix_table(c->limits);
+}
+
+/*
+ * mutate - derive a neighbour of table from: move one or two boundaries
+ *     to a nearby requested size, or scale them
+ */
+static void mutate(const cand_t *from, cand_t *to)
+{
+    *to = *from;
+    int moves = 1 + rand() % 2;
+
+    for (int m = 0; m < moves; m++)
+    {
+        int k = rand() % (nclasses - 1);
+        if (rand() % 2)
+        {
+            /* jump to a requested size a little above or below */
+            size_t *pos = bsearch(&to->limits[k], sizes, nsizes, sizeof(size_t), cmp_size);
+            long i = pos ? pos - sizes : rand() % nsizes;
+            i += (rand() % 2 ? 1 : -1) * (1 + rand() % (nsizes / 64 + 1));
+            i = i < 0 ? 0 : (i >= nsizes ? nsizes - 1 : i);
+            to->limits[k] = sizes[i];
+        }
+        else
+        {
+            /* scale by 1/2 .. 2 */
+            double f = 0.5 + 1.5 * rand() / (double)RAND_MAX;
+            to->limits[k] = (size_t)(to->limits[k] * f);
+        }
+    }
+    fix_table(to->limits);
+}
+
+/*
+ * table_string - format limits as "31,63,..." (the MM_CLASSES syntax)
+ */
+static void table_string(const size_t *limits, char *buf, char *sep)
+{
+    buf[0] = '\0';
+    for (int i = 0; i < nclasses - 1; i++)
+        sprintf(buf + strlen(buf), "%s%lu", i ? sep : "", (unsigned long)limits[i]);
+}
+
+/*
+ * evaluate - run the driver on n candidates, up to jobs at a time, and
+ *     fill in their scores
+ */
+static void evaluate(cand_t *cands, int n)
+{
+    for (int first = 0; first < n; first += jobs)
+    {
+        int batch = (n - first < jobs) ? n - first : jobs;
+        pid_t pids[MAX_JOBS];
+        FILE *outs[MAX_JOBS];
+
+        /* start the batch ... */
+        for (int j = 0; j < batch; j++)
+        {
+            cand_t *c = &cands[first + j];
+            char env[MAXLINE];
+            int fds[2];
+
+            table_string(c->limits, env, ",");
+            if (pipe(fds) < 0 || (pids[j] = fork()) < 0)
+            {
+                perror("classtune");
+                exit(1);
+            }
+            if (pids[j] == 0)
+            {
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[0]);
+                close(fds[1]);
+                setenv("MM_CLASSES", env, 1);
+                execl(driver, driver, "-g", "-t", tracedir, (char *)NULL);
+                fprintf(stderr, "classtune: cannot run %s: %s\n", driver, strerror(errno));
+                _exit(1);
+            }
+            close(fds[1]);
+            outs[j] = fdopen(fds[0], "r");
+        }
+
+        /* ... and collect its results */
+        for (int j = 0; j < batch; j++)
+        {
+            cand_t *c = &cands[first + j];
+            char line[MAXLINE];
+            int correct = 0, ok = 0;
+
+            c->util = c->kops = 0;
+            while (fgets(line, sizeof(line), outs[j]) != NULL)
+            {
+                sscanf(line, "correct:%d", &correct);
+                ok += sscanf(line, "util:%lf", &c->util);
+                ok += sscanf(line, "kops:%lf", &c->kops);
+            }
+            fclose(outs[j]);
+            waitpid(pids[j], NULL, 0);
+
+            if (ok < 2 || correct != (int)(sizeof(default_tracefiles) / sizeof(char *) - 1))
+            {
+                c->score = -1;
+                continue;
+            }
+            double thru = c->kops * 1e3 / AVG_LIBC_THRUPUT;
+            c->score = util_weight * c->util + (1.0 - util_weight) * (thru > 1.0 ? 1.0 : thru);
+        }
+    }
+}
+
+/*
+ * write_header - emit the chosen table as mm_classes.h
+ */
+static void write_header(const cand_t *best)
+{
+    char table[MAXLINE];
+    FILE *fp;
+
+    if ((fp = fopen(outfile, "w")) == NULL)
+    {
+        fprintf(stderr, "classtune: cannot write %s: %s\n", outfile, strerror(errno));
+        exit(1);
+    }
+    table_string(best->limits, table, ", ");
+    fprintf(fp,
+            "/*\n"
+            " * mm_classes.h - size class table compiled into mm.c\n"
+            " *\n"
+            " * MM_CLASS_LIMITS lists the largest block size (bytes) of every class\n"
+            " * except the last one, which takes all larger blocks. Regenerate it for\n"
+            " * a trace set with \"make tune-classes\" (see classtune.c).\n"
+            " *\n"
+            " * Generated by classtune: util %.4f, %.0f Kops, score %.4f (util weight %.2f)\n"
+            " */\n"
+            "#ifndef __MM_CLASSES_H_\n"
+            "#define __MM_CLASSES_H_\n"
+            "\n"
+            "#define MM_NUM_CLASSES %d\n"
+            "#define MM_CLASS_LIMITS {%s}\n"
+            "\n"
+            "#endif /* __MM_CLASSES_H_ */\n",
+            best->util, best->kops, best->score, util_weight, nclasses, table);
+    fclose(fp);
+}
+
+static void print_cand(const char *what, const cand_t *c)
+{
+    char table[MAXLINE];
+
+    table_string(c->limits, table, ",");
+    if (c->score < 0)
+        printf("%-10s failed           %s\n", what, table);
+    else
+        printf("%-10s %.4f  util %5.1f%%  %6.0f Kops  %s\n",
+               what, c->score, c->util * 100, c->kops, table);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: classtune [-h] [-j <jobs>] [-n <classes>] [-r <rounds>] [-w <util weight>]\n");
+    fprintf(stderr, "                 [-t <dir>] [-d <driver>] [-o <file>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-d <driver>   Driver built with -DMM_TUNE_CLASSES (default ./mdriver-tune).\n");
+    fprintf(stderr, "\t-h            Print this message.\n");
+    fprintf(stderr, "\t-j <jobs>     Candidates run in parallel (default: number of cores).\n");
+    fprintf(stderr, "\t-n <classes>  Number of size classes (default %d).\n", MM_NUM_CLASSES);
+    fprintf(stderr, "\t-o <file>     Header to write (default mm_classes.h).\n");
+    fprintf(stderr, "\t-r <rounds>   Hill-climbing rounds (default 20).\n");
+    fprintf(stderr, "\t-t <dir>      Directory to find default traces.\n");
+    fprintf(stderr, "\t-w <weight>   Weight of util in the score (default %.2f, as mdriver).\n", UTIL_WEIGHT);
+}
+
+int main(int argc, char **argv)
+{
+    int c;
+    cand_t *cands, best;
+
+    while ((c = getopt(argc, argv, "hj:n:r:w:t:d:o:")) != EOF)
+    {
+        switch (c)
+        {
+        case 'j':
+            jobs = atoi(optarg);
+            break;
+        case 'n':
+            nclasses = atoi(optarg);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 'w':
+            util_weight = atof(optarg);
+            break;
+        case 't':
+            strcpy(tracedir, optarg);
+            if (tracedir[strlen(tracedir) - 1] != '/')
+                strcat(tracedir, "/");
+            break;
+        case 'd':
+            driver = optarg;
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (nclasses < 2 || nclasses > MAX_CLASSES)
+    {
+        fprintf(stderr, "classtune: number of classes must be 2..%d\n", MAX_CLASSES);
+        exit(1);
+    }
+    if (jobs <= 0)
+        jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs > MAX_JOBS)
+        jobs = MAX_JOBS;
+    if (jobs < 3)
+        jobs = 3; /* room for the three seeds */
+    srand(1);
+
+    read_sizes();
+    if ((cands = calloc(jobs, sizeof(cand_t))) == NULL)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    printf("Tuning %d size classes on %d requests, %d candidates per round\n",
+           nclasses, nsizes, jobs);
+
+    /* Round 0: the seeds, padded with mutations of the current table */
+    seed_current(&cands[0]);
+    seed_pow2(&cands[1]);
+    seed_quantiles(&cands[2]);
+    for (int i = 3; i < jobs; i++)
+        mutate(&cands[i % 3], &cands[i]);
+    evaluate(cands, jobs);
+    print_cand("current", &cands[0]);
+    print_cand("pow2", &cands[1]);
+    print_cand("quantile", &cands[2]);
+
+    best = cands[0];
+    for (int i = 1; i < jobs; i++)
+        if (cands[i].score > best.score)
+            best = cands[i];
+
+    /* Hill climbing around the best table */
+    for (int r = 1; r <= rounds; r++)
+    {
+        char what[32];
+
+        for (int i = 0; i < jobs; i++)
+            mutate(&best, &cands[i]);
+        evaluate(cands, jobs);
+        for (int i = 0; i < jobs; i++)
+            if (cands[i].score > best.score)
+                best = cands[i];
+        sprintf(what, "round %d", r);
+        print_cand(what, &best);
+    }
+
+    if (best.score < 0)
+    {
+        fprintf(stderr, "classtune: no candidate ran successfully\n");
+        exit(1);
+    }
+    write_header(&best);
+    print_cand("best", &best);
+    printf("Wrote %s\n", outfile);
+    free(cands);
+    free(sizes);
+    return 0;
+}
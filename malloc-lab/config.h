@@ -62,6 +62,31 @@
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
+/*
+ * Number of trace operations per working-set window in the page
+ * measurement mode (mdriver -p)
+ */
+#define PAGE_WINDOW 1000
+
+/*
+ * Bytes mm_compact may move after every free in the movable handle
+ * replay (mdriver -c)
+ */
+#define COMPACT_BUDGET 4096
+
+/*
+ * Geometry of the cache/TLB model used by the instrumented build
+ * (make mdriver-cachesim). Sizes are in bytes.
+ */
+#define CSIM_LINE        64           /* cache line size */
+#define CSIM_L1_SIZE     (32*1024)    /* L1 data cache */
+#define CSIM_L1_WAYS     8
+#define CSIM_L2_SIZE     (256*1024)   /* unified L2 cache */
+#define CSIM_L2_WAYS     8
+#define CSIM_PAGE        4096         /* TLB page size */
+#define CSIM_TLB_ENTRIES 64           /* L1 data TLB */
+#define CSIM_TLB_WAYS    4
+
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <stdint.h>
 
 extern char *optarg; // Added declaration for optarg
 
@@ -22,6 +23,15 @@ extern char *optarg; // Added declaration for optarg
 #include "memlib.h"
 #include "fsecs.h"
 #include "config.h"
+#ifdef MM_CACHESIM
+#include "cachesim.h"
+#endif
+#ifdef MM_FAST
+/* Fast-path build: small mallocs/frees go through the inline caches */
+#include "mm_fast.h"
+#define mm_malloc mm_fast_malloc
+#define mm_free mm_fast_free
+#endif
 
 /**********************
  * Constants and macros
@@ -97,6 +107,39 @@ typedef struct
 	/* Note: secs and util are only defined if valid is true */
 } stats_t;
 
+/* Summarizes the page-level memory footprint of mm.c on some trace (-p) */
+typedef struct
+{
+	int valid;			/* was the trace measured? */
+	size_t logical;		/* pages needed by the peak live payload bytes */
+	size_t touched;		/* distinct pages touched by the trace */
+	size_t peak;		/* peak resident pages (sampled per window) */
+	size_t live;		/* peak pages holding live payload (sampled per window) */
+	double ws_avg;		/* average pages touched per PAGE_WINDOW ops */
+	size_t ws_max;		/* maximum pages touched per PAGE_WINDOW ops */
+} pages_t;
+
+/* Summarizes a replay of some trace through the movable handle API (-c) */
+typedef struct
+{
+	int valid;			   /* was the trace replayed? */
+	double util;		   /* peak payload bytes / peak heap size */
+	size_t peak_heap;	   /* peak heap size + mapped bytes */
+	unsigned long moves;   /* blocks moved by mm_compact */
+	unsigned long moved;   /* bytes moved by mm_compact */
+	unsigned long trimmed; /* bytes given back by trimming the heap */
+} compact_t;
+
+/* Summarizes how often small payloads of some trace straddle a boundary (-b) */
+typedef struct
+{
+	int valid;				/* was the trace replayed? */
+	unsigned long lines;	/* allocations of at most CSIM_LINE bytes */
+	unsigned long xlines;	/* ... whose payload touches two lines */
+	unsigned long pages;	/* allocations of at most CSIM_PAGE bytes */
+	unsigned long xpages;	/* ... whose payload touches two pages */
+} boundary_t;
+
 /********************
  * Global variables
  *******************/
@@ -134,9 +177,22 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_pages(trace_t *trace, pages_t *pages);
+static void eval_mm_compact(trace_t *trace, int tracenum, compact_t *compact);
+static void eval_mm_boundary(trace_t *trace, boundary_t *boundary);
+#ifdef MM_CACHESIM
+static void eval_mm_cache(trace_t *trace);
+#endif
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printpages(int n, pages_t *pages);
+static size_t count_live_pages(trace_t *trace, size_t **pagev, size_t *lenp);
+static void printcompact(int n, stats_t *stats, compact_t *compact);
+static void printboundary(int n, stats_t *stats, boundary_t *boundary);
+static void print_mm_ctl_stats(int tracenum, char *filename);
+static void print_mm_profile(int tracenum, char *filename);
+static void print_mm_lock_stats(int tracenum, char *filename);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -155,11 +211,17 @@ int main(int argc, char **argv)
 	range_t *ranges = NULL;		/* keeps track of block extents for one trace */
 	stats_t *libc_stats = NULL; /* libc stats for each trace */
 	stats_t *mm_stats = NULL;	/* mm (i.e. student) stats for each trace */
+	pages_t *mm_pages = NULL;	/* mm page footprint for each trace (-p) */
+	compact_t *mm_compact = NULL; /* mm handle replay for each trace (-c) */
+	boundary_t *mm_boundary = NULL; /* mm boundary crossings for each trace (-b) */
 	speed_t speed_params;		/* input parameters to the xx_speed routines */
 
 	int team_check = 1; /* If set, check team structure (reset by -a) */
 	int run_libc = 0;	/* If set, run libc malloc (set by -l) */
 	int autograder = 0; /* If set, emit summary info for autograder (-g) */
+	int run_pages = 0;	/* If set, measure page footprint of mm (set by -p) */
+	int run_compact = 0; /* If set, replay through mm_halloc (set by -c) */
+	int run_boundary = 0; /* If set, count line/page crossings (set by -b) */
 
 	/* temporaries used to compute the performance index */
 	double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -168,7 +230,7 @@ int main(int argc, char **argv)
 	/*
 	 * Read and interpret the command line arguments
 	 */
-	while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF)
+	while ((c = getopt(argc, argv, "f:t:hvVgalpcb")) != EOF)
 	{
 		printf("getopt returned: %d\n", c); // 디버깅용 출력 추가
 
@@ -198,6 +260,15 @@ int main(int argc, char **argv)
 		case 'l': /* Run libc malloc */
 			run_libc = 1;
 			break;
+		case 'p': /* Measure resident pages and working sets */
+			run_pages = 1;
+			break;
+		case 'c': /* Replay through the movable handle API with compaction */
+			run_compact = 1;
+			break;
+		case 'b': /* Count small payloads that straddle a cache line or page */
+			run_boundary = 1;
+			break;
 		case 'v': /* Print per-trace performance breakdown */
 			verbose = 1;
 			break;
@@ -307,6 +378,15 @@ int main(int argc, char **argv)
 	mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
 	if (mm_stats == NULL)
 		unix_error("mm_stats calloc in main failed");
+	if (run_pages &&
+		(mm_pages = (pages_t *)calloc(num_tracefiles, sizeof(pages_t))) == NULL)
+		unix_error("mm_pages calloc in main failed");
+	if (run_compact &&
+		(mm_compact = (compact_t *)calloc(num_tracefiles, sizeof(compact_t))) == NULL)
+		unix_error("mm_compact calloc in main failed");
+	if (run_boundary &&
+		(mm_boundary = (boundary_t *)calloc(num_tracefiles, sizeof(boundary_t))) == NULL)
+		unix_error("mm_boundary calloc in main failed");
 
 	/* Initialize the simulated memory system in memlib.c */
 	mem_init();
@@ -324,11 +404,25 @@ int main(int argc, char **argv)
 			if (verbose > 1)
 				printf("efficiency, ");
 			mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+			print_mm_ctl_stats(i, tracefiles[i]);
+			print_mm_profile(i, tracefiles[i]);
+			print_mm_lock_stats(i, tracefiles[i]);
 			speed_params.trace = trace;
 			speed_params.ranges = ranges;
 			if (verbose > 1)
 				printf("and performance.\n");
 			mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+			if (run_pages)
+				eval_mm_pages(trace, &mm_pages[i]);
+			if (run_compact)
+				eval_mm_compact(trace, i, &mm_compact[i]);
+			if (run_boundary)
+				eval_mm_boundary(trace, &mm_boundary[i]);
+#ifdef MM_CACHESIM
+			printf("\nSimulated cache misses for trace %d (%s):\n",
+				   i, tracefiles[i]);
+			eval_mm_cache(trace);
+#endif
 		}
 		free_trace(trace);
 	}
@@ -341,6 +435,33 @@ int main(int argc, char **argv)
 		printf("\n");
 	}
 
+	/* Display the page footprint, which is independent of -v */
+	if (run_pages)
+	{
+		printf("\nPage footprint for mm malloc (%lu-byte pages, %d-op windows):\n",
+			   (unsigned long)mem_pagesize(), PAGE_WINDOW);
+		printpages(num_tracefiles, mm_pages);
+		printf("\n");
+	}
+
+	/* Display the handle replay, which is independent of -v */
+	if (run_compact)
+	{
+		printf("\nMovable handle replay with mm_compact(%d) after every free:\n",
+			   COMPACT_BUDGET);
+		printcompact(num_tracefiles, mm_stats, mm_compact);
+		printf("\n");
+	}
+
+	/* Display the boundary crossings, which are independent of -v */
+	if (run_boundary)
+	{
+		printf("\nSmall payloads straddling a %d-byte line or a %d-byte page:\n",
+			   CSIM_LINE, CSIM_PAGE);
+		printboundary(num_tracefiles, mm_stats, mm_boundary);
+		printf("\n");
+	}
+
 	/*
 	 * Accumulate the aggregate statistics for the student's mm package
 	 */
@@ -392,6 +513,11 @@ int main(int argc, char **argv)
 	{
 		printf("correct:%d\n", numcorrect);
 		printf("perfidx:%.0f\n", perfindex);
+		if (errors == 0)
+		{
+			printf("util:%.4f\n", avg_mm_util);
+			printf("kops:%.0f\n", (ops / secs) / 1e3);
+		}
 	}
 
 	exit(0);
@@ -427,9 +553,11 @@ static int add_range(range_t **ranges, char *lo, int size,
 		return 0;
 	}
 
-	/* The payload must lie within the extent of the heap */
-	if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
-		(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi()))
+	/* The payload must lie within the extent of the heap (or within
+	   one of the mappings memlib made for large objects) */
+	if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
+		 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+		!mem_in_map(lo, hi))
 	{
 		sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 				lo, hi, mem_heap_lo(), mem_heap_hi());
@@ -735,10 +863,10 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
  *   The idea is to remember the high water mark "hwm" of the heap for
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the
- *   size of the heap in bytes after running the student's malloc
- *   package on the trace. Note that our implementation of mem_sbrk()
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap.
+ *   peak footprint of the student's malloc package on the trace: the
+ *   heap size plus the bytes memlib mapped for large objects, at their
+ *   highest (mem_peaksize). The brk can be decremented, so its final
+ *   value is not necessarily the high water mark any more.
  *
  */
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
@@ -765,6 +893,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 			index = trace->ops[i].index;
 			size = trace->ops[i].size;
 
+			mm_prof_set_site(size); /* traces carry no call sites */
 			if ((p = mm_malloc(size)) == NULL)
 				app_error("mm_malloc failed in eval_mm_util");
 
@@ -786,6 +915,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 			oldsize = trace->block_sizes[index];
 
 			oldp = trace->blocks[index];
+			mm_prof_set_site(newsize);
 			if ((newp = mm_realloc(oldp, newsize)) == NULL)
 				app_error("mm_realloc failed in eval_mm_util");
 
@@ -819,7 +949,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 		}
 	}
 
-	return ((double)max_total_size / (double)mem_heapsize());
+	mm_prof_set_site(0);
+	return ((double)max_total_size / (double)mem_peaksize());
 }
 
 /*
@@ -870,6 +1001,280 @@ static void eval_mm_speed(void *ptr)
 		}
 }
 
+/* cmp_size - qsort comparator for size_t */
+static int cmp_size(const void *a, const void *b)
+{
+	size_t x = *(const size_t *)a, y = *(const size_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * count_live_pages - returns the number of distinct pages that hold at
+ *    least one payload byte of a live block (trace->blocks[] is NULL for
+ *    blocks that are not live). *pagev is a scratch array of *lenp
+ *    entries, grown as needed.
+ */
+static size_t count_live_pages(trace_t *trace, size_t **pagev, size_t *lenp)
+{
+	size_t pagesize = mem_pagesize();
+	size_t n = 0, distinct = 0;
+	int i;
+
+	for (i = 0; i < trace->num_ids; i++)
+	{
+		uintptr_t lo, hi;
+
+		if (trace->blocks[i] == NULL || trace->block_sizes[i] == 0)
+			continue;
+		lo = (uintptr_t)trace->blocks[i] / pagesize;
+		hi = ((uintptr_t)trace->blocks[i] + trace->block_sizes[i] - 1) / pagesize;
+		for (; lo <= hi; lo++)
+		{
+			if (n == *lenp)
+			{
+				*lenp = *lenp ? 2 * *lenp : 1024;
+				if ((*pagev = (size_t *)realloc(*pagev, *lenp * sizeof(size_t))) == NULL)
+					unix_error("realloc failed in count_live_pages");
+			}
+			(*pagev)[n++] = lo;
+		}
+	}
+	qsort(*pagev, n, sizeof(size_t), cmp_size);
+	for (i = 0; i < (int)n; i++)
+		distinct += (i == 0 || (*pagev)[i] != (*pagev)[i - 1]);
+	return distinct;
+}
+
+/*
+ * eval_mm_pages - Measure the page-level footprint of the mm package.
+ *    The heap's physical pages are released first, so every page that is
+ *    resident afterwards was touched by mm.c or by the payload writes
+ *    (which are done here as in eval_mm_valid). Every page the trace
+ *    touches is counted once, including pages that are given back before
+ *    the end (trimmed heap, unmapped large objects). Every PAGE_WINDOW ops the
+ *    resident page count (heap and large object mappings) and the number
+ *    of pages holding live payload bytes are sampled, and the number of
+ *    distinct pages touched in that window (the working set) is recorded.
+ *    Pages that are resident but hold no live payload could have been
+ *    given back by the allocator.
+ */
+static void eval_mm_pages(trace_t *trace, pages_t *pages)
+{
+	int i, index, size;
+	int total_size = 0;
+	int max_total_size = 0;
+	int windows = 0;
+	size_t ws, ws_total = 0, resident, live;
+	size_t pagesize = mem_pagesize();
+	char *p, *newp, *oldp;
+	size_t *pagev = NULL, pagev_len = 0;
+
+	memset(pages, 0, sizeof(pages_t));
+	memset(trace->blocks, 0, trace->num_ids * sizeof(char *)); /* NULL: not live */
+
+	/* Start from an empty heap with no resident pages */
+	mem_reset_brk();
+	mem_release_pages();
+
+	mem_track_begin();
+	if (mm_init() < 0)
+		app_error("mm_init failed in eval_mm_pages");
+
+	for (i = 0; i < trace->num_ops; i++)
+	{
+		index = trace->ops[i].index;
+		size = trace->ops[i].size;
+
+		switch (trace->ops[i].type)
+		{
+		case ALLOC: /* mm_malloc */
+			if ((p = mm_malloc(size)) == NULL)
+				app_error("mm_malloc failed in eval_mm_pages");
+			memset(p, index & 0xFF, size);
+			trace->blocks[index] = p;
+			trace->block_sizes[index] = size;
+			total_size += size;
+			break;
+
+		case REALLOC: /* mm_realloc */
+			oldp = trace->blocks[index];
+			if ((newp = mm_realloc(oldp, size)) == NULL)
+				app_error("mm_realloc failed in eval_mm_pages");
+			memset(newp, index & 0xFF, size);
+			total_size += size - (int)trace->block_sizes[index];
+			trace->blocks[index] = newp;
+			trace->block_sizes[index] = size;
+			break;
+
+		case FREE: /* mm_free */
+			mm_free(trace->blocks[index]);
+			trace->blocks[index] = NULL;
+			total_size -= trace->block_sizes[index];
+			break;
+
+		default:
+			app_error("Nonexistent request type in eval_mm_pages");
+		}
+		max_total_size = (total_size > max_total_size) ? total_size : max_total_size;
+
+		/* Close the window at every PAGE_WINDOW ops and at the end */
+		if ((i + 1) % PAGE_WINDOW == 0 || i == trace->num_ops - 1)
+		{
+			ws = mem_track_end();
+			ws_total += ws;
+			windows++;
+			pages->ws_max = (ws > pages->ws_max) ? ws : pages->ws_max;
+			resident = mem_resident_pages();
+			pages->peak = (resident > pages->peak) ? resident : pages->peak;
+			live = count_live_pages(trace, &pagev, &pagev_len);
+			pages->live = (live > pages->live) ? live : pages->live;
+			if (i < trace->num_ops - 1)
+				mem_track_begin();
+		}
+	}
+	if (windows == 0) /* empty trace: close the window opened for mm_init */
+		ws_total = mem_track_end(), windows = 1;
+
+	free(pagev);
+	pages->touched = mem_touched_pages();
+	pages->logical = (max_total_size + pagesize - 1) / pagesize;
+	pages->ws_avg = (double)ws_total / windows;
+	pages->valid = 1;
+}
+
+/*
+ * eval_mm_compact - Replay the trace through the movable handle API
+ *    (mm_halloc/mm_hrealloc/mm_hfree), calling mm_compact after every
+ *    free. Every block is filled while pinned and checked again before it
+ *    is freed, so a block corrupted by the compactor is reported as an
+ *    error. Utilization is the peak payload over the peak heap size,
+ *    since compaction may lower the brk again.
+ */
+static void eval_mm_compact(trace_t *trace, int tracenum, compact_t *compact)
+{
+	int i, j, index, size;
+	int total_size = 0;
+	int max_total_size = 0;
+	mm_handle_t *handles;
+	unsigned char *p;
+
+	memset(compact, 0, sizeof(compact_t));
+	if ((handles = (mm_handle_t *)calloc(trace->num_ids, sizeof(mm_handle_t))) == NULL)
+		unix_error("calloc failed in eval_mm_compact");
+
+	mem_reset_brk();
+	if (mm_init() < 0)
+		app_error("mm_init failed in eval_mm_compact");
+
+	for (i = 0; i < trace->num_ops; i++)
+	{
+		index = trace->ops[i].index;
+		size = trace->ops[i].size;
+
+		switch (trace->ops[i].type)
+		{
+		case ALLOC: /* mm_halloc */
+			if ((handles[index] = mm_halloc(size)) == 0)
+			{
+				free(handles); /* e.g. mdriver-cpp has no handle API */
+				return;
+			}
+			memset(mm_hpin(handles[index]), index & 0xFF, size);
+			mm_hunpin(handles[index]);
+			trace->block_sizes[index] = size;
+			total_size += size;
+			break;
+
+		case REALLOC: /* mm_hrealloc */
+			if (mm_hrealloc(handles[index], size) < 0)
+				app_error("mm_hrealloc failed in eval_mm_compact");
+			memset(mm_hpin(handles[index]), index & 0xFF, size);
+			mm_hunpin(handles[index]);
+			total_size += size - (int)trace->block_sizes[index];
+			trace->block_sizes[index] = size;
+			break;
+
+		case FREE: /* mm_hfree */
+			p = mm_hpin(handles[index]);
+			for (j = 0; j < (int)trace->block_sizes[index]; j++)
+			{
+				if (p[j] != (index & 0xFF))
+				{
+					malloc_error(tracenum, i, "mm_compact corrupted the payload of a movable block");
+					break;
+				}
+			}
+			mm_hunpin(handles[index]);
+			mm_hfree(handles[index]);
+			total_size -= trace->block_sizes[index];
+			mm_compact(COMPACT_BUDGET);
+			break;
+
+		default:
+			app_error("Nonexistent request type in eval_mm_compact");
+		}
+		max_total_size = (total_size > max_total_size) ? total_size : max_total_size;
+	}
+
+	compact->peak_heap = mem_peaksize();
+	compact->util = (double)max_total_size / compact->peak_heap;
+	mm_ctl("compact.moves", &compact->moves);
+	mm_ctl("compact.moved_bytes", &compact->moved);
+	mm_ctl("compact.trimmed_bytes", &compact->trimmed);
+	compact->valid = 1;
+	free(handles);
+}
+
+#ifdef MM_CACHESIM
+/*
+ * eval_mm_cache - Replay the trace once with the cache/TLB model enabled,
+ *    starting from cold caches, and print the simulated accesses and
+ *    misses per op for each mm.c function. Only in the instrumented
+ *    build (make mdriver-cachesim).
+ */
+static void eval_mm_cache(trace_t *trace)
+{
+	int i, index, size;
+	char *p, *newp;
+
+	mem_reset_brk();
+	cachesim_reset();
+	cachesim_enable(1);
+	if (mm_init() < 0)
+		app_error("mm_init failed in eval_mm_cache");
+
+	for (i = 0; i < trace->num_ops; i++)
+	{
+		index = trace->ops[i].index;
+		size = trace->ops[i].size;
+
+		switch (trace->ops[i].type)
+		{
+		case ALLOC: /* mm_malloc */
+			if ((p = mm_malloc(size)) == NULL)
+				app_error("mm_malloc failed in eval_mm_cache");
+			trace->blocks[index] = p;
+			break;
+
+		case REALLOC: /* mm_realloc */
+			if ((newp = mm_realloc(trace->blocks[index], size)) == NULL)
+				app_error("mm_realloc failed in eval_mm_cache");
+			trace->blocks[index] = newp;
+			break;
+
+		case FREE: /* mm_free */
+			mm_free(trace->blocks[index]);
+			break;
+
+		default:
+			app_error("Nonexistent request type in eval_mm_cache");
+		}
+	}
+	cachesim_enable(0);
+	cachesim_print(trace->num_ops);
+}
+#endif
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -1026,6 +1431,277 @@ static void printresults(int n, stats_t *stats)
 	}
 }
 
+/*
+ * printpages - prints the page footprint summary of the mm package
+ */
+static void printpages(int n, pages_t *pages)
+{
+	int i;
+	size_t logical = 0, touched = 0, peak = 0, live = 0;
+
+	printf("%5s%9s%9s%8s%8s%9s%8s%7s\n",
+		   "trace", "logical", "touched", "peak", "live", "ws_avg", "ws_max", "ratio");
+	for (i = 0; i < n; i++)
+	{
+		if (!pages[i].valid)
+		{
+			printf("%2d%12s%9s%8s%8s%9s%8s%7s\n", i, "-", "-", "-", "-", "-", "-", "-");
+			continue;
+		}
+		printf("%2d%12lu%9lu%8lu%8lu%9.1f%8lu%7.2f\n",
+			   i,
+			   (unsigned long)pages[i].logical,
+			   (unsigned long)pages[i].touched,
+			   (unsigned long)pages[i].peak,
+			   (unsigned long)pages[i].live,
+			   pages[i].ws_avg,
+			   (unsigned long)pages[i].ws_max,
+			   (double)pages[i].peak / (pages[i].logical ? pages[i].logical : 1));
+		logical += pages[i].logical;
+		touched += pages[i].touched;
+		peak += pages[i].peak;
+		live += pages[i].live;
+	}
+	printf("%5s%9lu%9lu%8lu%8lu%24.2f\n",
+		   "Total",
+		   (unsigned long)logical,
+		   (unsigned long)touched,
+		   (unsigned long)peak,
+		   (unsigned long)live,
+		   (double)peak / (logical ? logical : 1));
+}
+
+/*
+ * eval_mm_boundary - Replay the trace and count, for every payload handed
+ *    out by mm_malloc/mm_realloc, whether one access to the whole payload
+ *    touches two cache lines (payloads of at most CSIM_LINE bytes) or two
+ *    pages (payloads of at most CSIM_PAGE bytes). Either would fit in one.
+ */
+static void eval_mm_boundary(trace_t *trace, boundary_t *boundary)
+{
+	int i, index, size;
+	char *p;
+
+	memset(boundary, 0, sizeof(boundary_t));
+	mem_reset_brk();
+	if (mm_init() < 0)
+		app_error("mm_init failed in eval_mm_boundary");
+
+	for (i = 0; i < trace->num_ops; i++)
+	{
+		index = trace->ops[i].index;
+		size = trace->ops[i].size;
+
+		switch (trace->ops[i].type)
+		{
+		case ALLOC: /* mm_malloc */
+		case REALLOC: /* mm_realloc */
+			if (trace->ops[i].type == ALLOC)
+				p = mm_malloc(size);
+			else
+				p = mm_realloc(trace->blocks[index], size);
+			if (p == NULL)
+				app_error("mm_malloc/mm_realloc failed in eval_mm_boundary");
+			trace->blocks[index] = p;
+			if (size == 0)
+				break;
+			if (size <= CSIM_LINE)
+			{
+				boundary->lines++;
+				if ((uintptr_t)p / CSIM_LINE != ((uintptr_t)p + size - 1) / CSIM_LINE)
+					boundary->xlines++;
+			}
+			if (size <= CSIM_PAGE)
+			{
+				boundary->pages++;
+				if ((uintptr_t)p / CSIM_PAGE != ((uintptr_t)p + size - 1) / CSIM_PAGE)
+					boundary->xpages++;
+			}
+			break;
+
+		case FREE: /* mm_free */
+			mm_free(trace->blocks[index]);
+			break;
+
+		default:
+			app_error("Nonexistent request type in eval_mm_boundary");
+		}
+	}
+	boundary->valid = 1;
+}
+
+/*
+ * printcompact - prints the handle replay next to the plain mm_malloc
+ *    utilization of every trace
+ */
+static void printcompact(int n, stats_t *stats, compact_t *compact)
+{
+	int i;
+
+	printf("%5s%8s%8s%10s%8s%11s%10s\n",
+		   "trace", "util", "hutil", "peak", "moves", "moved", "trimmed");
+	for (i = 0; i < n; i++)
+	{
+		if (!compact[i].valid)
+		{
+			printf("%2d%11s%8s%10s%8s%11s%10s\n", i, "-", "-", "-", "-", "-", "-");
+			continue;
+		}
+		printf("%2d%10.1f%%%7.1f%%%10lu%8lu%11lu%10lu\n",
+			   i,
+			   stats[i].util * 100.0,
+			   compact[i].util * 100.0,
+			   (unsigned long)compact[i].peak_heap,
+			   compact[i].moves,
+			   compact[i].moved,
+			   compact[i].trimmed);
+	}
+}
+
+/*
+ * printboundary - prints the share of small payloads that straddle a
+ *    line or a page next to the utilization of every trace
+ */
+static void printboundary(int n, stats_t *stats, boundary_t *boundary)
+{
+	int i;
+	unsigned long lines = 0, xlines = 0, pages = 0, xpages = 0;
+
+	printf("%5s%8s%9s%9s%9s%9s\n",
+		   "trace", "util", "lines", "xline", "pages", "xpage");
+	for (i = 0; i < n; i++)
+	{
+		if (!boundary[i].valid)
+		{
+			printf("%2d%11s%9s%9s%9s%9s\n", i, "-", "-", "-", "-", "-");
+			continue;
+		}
+		printf("%2d%10.1f%%%9lu%8.1f%%%9lu%8.1f%%\n",
+			   i,
+			   stats[i].util * 100.0,
+			   boundary[i].lines,
+			   100.0 * boundary[i].xlines / (boundary[i].lines ? boundary[i].lines : 1),
+			   boundary[i].pages,
+			   100.0 * boundary[i].xpages / (boundary[i].pages ? boundary[i].pages : 1));
+		lines += boundary[i].lines;
+		xlines += boundary[i].xlines;
+		pages += boundary[i].pages;
+		xpages += boundary[i].xpages;
+	}
+	printf("%5s%17lu%8.1f%%%9lu%8.1f%%\n",
+		   "Total",
+		   lines,
+		   100.0 * xlines / (lines ? lines : 1),
+		   pages,
+		   100.0 * xpages / (pages ? pages : 1));
+}
+
+/*
+ * print_mm_ctl_stats - dump the mm package's internal counters (mm_ctl)
+ *    after the single replay done by eval_mm_util. Prints nothing unless
+ *    mm.c was built with MM_STATS (make mdriver-stats).
+ */
+static void print_mm_ctl_stats(int tracenum, char *filename)
+{
+	static char *names[] = {
+		"stats.find_fit.calls",
+		"stats.find_fit.visits",
+		"stats.find_fit.misses",
+		"stats.coalesce.case1",
+		"stats.coalesce.case2",
+		"stats.coalesce.case3",
+		"stats.coalesce.case4",
+		"stats.place.splits",
+		"stats.place.boundary_shifts",
+		"stats.place.boundary_lead_bytes",
+		"stats.dv.hits",
+		"stats.wild.allocs",
+		"stats.extend_heap.calls",
+		"stats.extend_heap.bytes",
+		"stats.realloc.inplace",
+		"stats.realloc.move",
+		"stats.realloc.copy",
+		"stats.realloc.copied_bytes",
+		"stats.realloc.nt_bytes",
+		"stats.realloc.copy_ns",
+		"stats.large.maps",
+		"stats.large.remaps",
+		NULL};
+	char name[MAXLINE];
+	unsigned long v, nclasses, mallocs, frees, reallocs;
+	int i;
+
+	if (mm_ctl("stats.nclasses", &nclasses) < 0)
+		return;
+
+	printf("\nmm stats for trace %d (%s):\n", tracenum, filename);
+	for (i = 0; names[i] != NULL; i++)
+	{
+		if (mm_ctl(names[i], &v) == 0)
+			printf("  %-28s %12lu\n", names[i], v);
+	}
+	printf("  %-8s%10s%10s%10s\n", "class", "mallocs", "frees", "reallocs");
+	for (i = 0; i < (int)nclasses; i++)
+	{
+		sprintf(name, "stats.class.%d.mallocs", i);
+		mm_ctl(name, &mallocs);
+		sprintf(name, "stats.class.%d.frees", i);
+		mm_ctl(name, &frees);
+		sprintf(name, "stats.class.%d.reallocs", i);
+		mm_ctl(name, &reallocs);
+		if (mallocs || frees || reallocs)
+			printf("  %-8d%10lu%10lu%10lu\n", i, mallocs, frees, reallocs);
+	}
+}
+
+/*
+ * print_mm_lock_stats - after the utilization replay, print the mm
+ *    package's lock contention report. Does nothing unless mm.c was
+ *    built with MM_THREADS and MM_LOCKPROF (make mdriver-lockprof).
+ *    The driver is single-threaded, so this mostly shows how often each
+ *    function takes the lock; mtbench-lockprof -v shows real contention.
+ */
+static void print_mm_lock_stats(int tracenum, char *filename)
+{
+	unsigned long nlocks;
+
+	if (mm_ctl("lock.nlocks", &nlocks) < 0)
+		return;
+
+	printf("\nmm locks for trace %d (%s):\n", tracenum, filename);
+	mm_lock_report(stdout);
+}
+
+/*
+ * print_mm_profile - after the utilization replay, print the top sampled
+ *    allocation sites and write the pprof heap profile to
+ *    <tracefile>.heap in the current directory. Does nothing unless mm.c
+ *    was built with MM_PROFILE (make mdriver-prof). Traces carry no call
+ *    sites, so eval_mm_util passes the request size as the site id.
+ */
+static void print_mm_profile(int tracenum, char *filename)
+{
+	unsigned long period;
+	char path[MAXLINE];
+	char *base;
+	FILE *fp;
+
+	if (mm_ctl("prof.sample_bytes", &period) < 0)
+		return;
+
+	printf("\nSampled heap profile for trace %d (%s), 1 sample per %lu bytes:\n",
+		   tracenum, filename, period);
+	mm_prof_report(stdout, 10);
+
+	base = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+	sprintf(path, "%s.heap", base);
+	if ((fp = fopen(path, "w")) == NULL)
+		unix_error("fopen failed in print_mm_profile");
+	mm_prof_dump(fp);
+	fclose(fp);
+	printf("  pprof profile written to %s\n", path);
+}
+
 /*
  * app_error - Report an arbitrary application error
  */
@@ -1058,13 +1734,16 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void)
 {
-	fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+	fprintf(stderr, "Usage: mdriver [-hvValpcb] [-f <file>] [-t <dir>]\n");
 	fprintf(stderr, "Options\n");
 	fprintf(stderr, "\t-a         Don't check the team structure.\n");
+	fprintf(stderr, "\t-b         Count small payloads straddling a cache line or page.\n");
+	fprintf(stderr, "\t-c         Replay through the movable handle API with compaction.\n");
 	fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
 	fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
 	fprintf(stderr, "\t-h         Print this message.\n");
 	fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+	fprintf(stderr, "\t-p         Report resident pages and working sets.\n");
 	fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
 	fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
 	fprintf(stderr, "\t-V         Print additional debug info.\n");
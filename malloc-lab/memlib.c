@@ -3,6 +3,7 @@
  *            allows us to interleave calls from the student's malloc package
  *            with the system's malloc package in libc.
  */
+#define _GNU_SOURCE /* mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -10,24 +11,59 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <signal.h>
 
 #include "memlib.h"
 #include "config.h"
 
+static size_t mem_count_resident(char *start, size_t len);
+
 /* private variables */
 static char *mem_start_brk; /* points to first byte of heap */
 static char *mem_brk;       /* points to last byte of heap */
 static char *mem_max_addr;  /* largest legal heap address */
+static size_t mem_peak;     /* peak of heap size + mapped bytes since mem_reset_brk */
+
+/*
+ * large objects mapped outside the brk heap (mem_map/mem_remap). The caller
+ * keeps the slot number mem_map returns and passes it to mem_remap and
+ * mem_unmap, so neither has to search. Free slots are kept on a stack
+ * (slots are never moved, the numbers the caller holds stay valid).
+ */
+#define MAX_MAPS 1024
+static struct
+{
+    char *addr; /* NULL: free slot */
+    size_t len;
+} mem_maps[MAX_MAPS];
+static int mem_free_slots[MAX_MAPS]; /* stack of free slots below mem_nslots */
+static int mem_nfree;
+static int mem_nslots;    /* slots [0, mem_nslots) have been used */
+static size_t mem_mapped; /* bytes currently mapped */
+
+/* page tracking state (used only by the driver's -p mode) */
+static struct sigaction mem_old_segv; /* SIGSEGV handler saved by mem_track_begin */
+static size_t mem_touched;            /* pages faulted in since mem_track_begin */
+static int mem_tracking;              /* between mem_track_begin and mem_track_end */
+static unsigned char mem_hit[MAX_HEAP / 4096 / 8 + 1]; /* heap pages faulted in since mem_reset_brk */
+static size_t mem_hit_pages;          /* bits set in mem_hit */
+static size_t mem_unmapped_pages;     /* resident pages of mappings unmapped while tracking */
 
 /*
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
-    /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL)
+    /*
+     * allocate the storage we will use to model the available VM.
+     * The heap is mmap'ed so that it is page aligned and its residency
+     * can be queried with mincore (see mem_resident_pages).
+     */
+    mem_start_brk = (char *)mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem_start_brk == MAP_FAILED)
     {
-        fprintf(stderr, "mem_init_vm: malloc error\n");
+        fprintf(stderr, "mem_init_vm: mmap error\n");
         exit(1);
     }
 
@@ -41,7 +77,7 @@ void mem_init(void)
 // mem_init()로 할당한 시뮬레이션 힙을 해제합니다.
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    munmap(mem_start_brk, MAX_HEAP);
 }
 
 /*
@@ -51,20 +87,42 @@ void mem_deinit(void)
 void mem_reset_brk()
 {
     mem_brk = mem_start_brk;
+    mem_peak = 0;
+
+    // 이전 힙의 큰 객체 매핑도 모두 반환
+    for (int i = 0; i < mem_nslots; i++)
+        if (mem_maps[i].addr != NULL)
+            mem_unmap(i);
+    mem_nslots = 0;
+    mem_nfree = 0;
+    memset(mem_hit, 0, sizeof(mem_hit));
+    mem_hit_pages = 0;
+    mem_unmapped_pages = 0;
+}
+
+/*
+ * mem_update_peak - record the current heap size + mapped bytes
+ */
+static void mem_update_peak(void)
+{
+    size_t footprint = (size_t)(mem_brk - mem_start_brk) + mem_mapped;
+    if (footprint > mem_peak)
+        mem_peak = footprint;
 }
 
 /*
  * mem_sbrk - simple model of the sbrk function. Extends the heap
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area.
+ *    A negative incr shrinks the heap (never below its start), and the
+ *    whole pages above the new brk are given back to the kernel.
  */
-void *mem_sbrk(int incr) // incr : 늘리려는 바이트 크기
+void *mem_sbrk(int incr) // incr : 늘리려는 바이트 크기 (음수면 줄임)
 {
     // 1. 할당 전 끝 주소를 old_brk 초기회 및 늘렸을 때, Max 넘어서는지 검사용
     char *old_brk = mem_brk;
 
-    // 2. 음수 바이트 할당 오류 || 최대를 넘어선다면, => 오류
-    if ((incr < 0) || ((mem_brk + incr) > mem_max_addr))
+    // 2. 시작 아래로 줄이거나 || 최대를 넘어선다면, => 오류
+    if ((mem_brk + incr < mem_start_brk) || ((mem_brk + incr) > mem_max_addr))
     {
 
         // 12	/* Out of memory */
@@ -75,11 +133,125 @@ void *mem_sbrk(int incr) // incr : 늘리려는 바이트 크기
         return (void *)-1;
     }
     mem_brk += incr;
+    mem_update_peak();
+    if (incr < 0)
+    {
+        // 줄어든 부분 중 통째로 비는 페이지만 반환 (내용은 0이 됨)
+        size_t pagesize = mem_pagesize();
+        char *lo = mem_start_brk + ((mem_brk - mem_start_brk + pagesize - 1) / pagesize) * pagesize;
+        if (lo < old_brk)
+            madvise(lo, old_brk - lo, MADV_DONTNEED);
+    }
     // mem_brk를 반환하는 것이 아닌 시작 주소를 반환
     // 이유 : 할당 후, 그 할당된 메모리 안에 값을 시작점부터 넣어야 하기 때문
     return (void *)old_brk;
 }
 
+/*
+ * mem_map - map len bytes (a multiple of the page size) for a large
+ *    object outside the brk heap and store its slot number in *slot.
+ *    Returns NULL on failure or when all MAX_MAPS slots are in use.
+ */
+void *mem_map(size_t len, int *slot)
+{
+    char *p;
+    int i;
+
+    if (mem_nfree == 0 && mem_nslots == MAX_MAPS)
+        return NULL;
+    // 페이지 추적 중이면 힙처럼 보호해 두고 첫 접근에서 센다
+    p = mmap(NULL, len, mem_tracking ? PROT_NONE : PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    i = mem_nfree > 0 ? mem_free_slots[--mem_nfree] : mem_nslots++;
+    mem_maps[i].addr = p;
+    mem_maps[i].len = len;
+    mem_mapped += len;
+    mem_update_peak();
+    *slot = i;
+    return p;
+}
+
+/*
+ * mem_remap - grow or shrink the mapping in slot to new_len bytes. The
+ *    kernel moves the page table entries if the mapping cannot grow in
+ *    place, so no bytes are copied. Returns the (possibly new) address,
+ *    or NULL on failure with the old mapping left intact.
+ */
+void *mem_remap(int slot, size_t new_len)
+{
+    char *np;
+
+    np = mremap(mem_maps[slot].addr, mem_maps[slot].len, new_len, MREMAP_MAYMOVE);
+    if (np == MAP_FAILED)
+        return NULL;
+    mem_mapped += new_len - mem_maps[slot].len;
+    mem_maps[slot].addr = np;
+    mem_maps[slot].len = new_len;
+    mem_update_peak();
+    return np;
+}
+
+/*
+ * mem_unmap - unmap the large object in slot and free the slot
+ */
+void mem_unmap(int slot)
+{
+    // 추적 중이면 사라질 페이지도 '건드린 페이지'로 남김 (mem_touched_pages)
+    if (mem_tracking)
+        mem_unmapped_pages += mem_count_resident(mem_maps[slot].addr, mem_maps[slot].len);
+    munmap(mem_maps[slot].addr, mem_maps[slot].len);
+    mem_mapped -= mem_maps[slot].len;
+    mem_maps[slot].addr = NULL;
+    mem_free_slots[mem_nfree++] = slot;
+}
+
+/*
+ * mem_map_slot - returns the slot of the large object mapping that holds
+ *    p and stores p's offset in it in *offset, or returns -1 if p lies in
+ *    no mapping
+ */
+int mem_map_slot(const void *p, size_t *offset)
+{
+    for (int i = 0; i < mem_nslots; i++)
+        if (mem_maps[i].addr != NULL &&
+            (const char *)p >= mem_maps[i].addr && (const char *)p < mem_maps[i].addr + mem_maps[i].len)
+        {
+            *offset = (size_t)((const char *)p - mem_maps[i].addr);
+            return i;
+        }
+    return -1;
+}
+
+/*
+ * mem_in_map - returns 1 if [lo, hi] lies inside one large object mapping
+ */
+int mem_in_map(void *lo, void *hi)
+{
+    size_t off;
+    int i = mem_map_slot(lo, &off);
+
+    return i >= 0 && (char *)hi < mem_maps[i].addr + mem_maps[i].len;
+}
+
+/*
+ * mem_mapsize - returns the bytes currently mapped for large objects
+ */
+size_t mem_mapsize(void)
+{
+    return mem_mapped;
+}
+
+/*
+ * mem_peaksize - returns the peak of heap size + mapped bytes since the
+ *    last mem_reset_brk, the footprint the utilization is measured against
+ */
+size_t mem_peaksize(void)
+{
+    return mem_peak;
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
@@ -111,3 +283,147 @@ size_t mem_pagesize()
 {
     return (size_t)getpagesize();
 }
+
+/*
+ * mem_release_pages - drop every physical page backing the heap, so the
+ *    next run starts with zero resident pages. The contents become zero.
+ */
+void mem_release_pages(void)
+{
+    madvise(mem_start_brk, MAX_HEAP, MADV_DONTNEED);
+}
+
+/*
+ * mem_count_resident - returns the number of resident pages in the
+ *    page-aligned range [start, start + len)
+ */
+static size_t mem_count_resident(char *start, size_t len)
+{
+    size_t pagesize = mem_pagesize();
+    size_t npages = (len + pagesize - 1) / pagesize;
+    size_t resident = 0;
+    unsigned char vec[256];
+
+    // mincore는 페이지당 1바이트를 채우므로 vec 크기 단위로 나눠서 조회
+    for (size_t i = 0; i < npages; i += sizeof(vec))
+    {
+        size_t n = npages - i < sizeof(vec) ? npages - i : sizeof(vec);
+        if (mincore(start + i * pagesize, n * pagesize, vec) < 0)
+            return 0;
+        for (size_t j = 0; j < n; j++)
+            resident += vec[j] & 1;
+    }
+    return resident;
+}
+
+/*
+ * mem_resident_pages - returns the number of resident pages in [lo, brk)
+ *    plus those of the live large object mappings
+ */
+size_t mem_resident_pages(void)
+{
+    size_t resident = mem_count_resident(mem_start_brk, mem_heapsize());
+
+    for (int i = 0; i < mem_nslots; i++)
+        if (mem_maps[i].addr != NULL)
+            resident += mem_count_resident(mem_maps[i].addr, mem_maps[i].len);
+    return resident;
+}
+
+/*
+ * mem_touched_pages - returns the number of distinct pages touched since
+ *    mem_reset_brk while page tracking was on: heap pages that faulted in,
+ *    plus the resident pages of large object mappings, both live and
+ *    unmapped. A mapping's pages are only resident once touched.
+ */
+size_t mem_touched_pages(void)
+{
+    size_t pages = mem_hit_pages + mem_unmapped_pages;
+
+    for (int i = 0; i < mem_nslots; i++)
+        if (mem_maps[i].addr != NULL)
+            pages += mem_count_resident(mem_maps[i].addr, mem_maps[i].len);
+    return pages;
+}
+
+/*
+ * mem_page_fault - SIGSEGV handler installed by mem_track_begin. Unprotects
+ *    the faulting page of the heap or of a large object mapping and counts
+ *    it as touched. Other faults are passed on to the default action.
+ */
+static void mem_page_fault(int sig, siginfo_t *si, void *ctx)
+{
+    char *addr = (char *)si->si_addr;
+    size_t pagesize = mem_pagesize();
+    char *base = NULL;
+    size_t off;
+    int slot;
+
+    if (addr >= mem_start_brk && addr < mem_max_addr)
+        base = mem_start_brk;
+    else if ((slot = mem_map_slot(addr, &off)) >= 0)
+        base = mem_maps[slot].addr;
+    if (base == NULL)
+    {
+        signal(SIGSEGV, SIG_DFL); /* re-fault and die as usual */
+        return;
+    }
+    addr = base + ((addr - base) / pagesize) * pagesize;
+    mprotect(addr, pagesize, PROT_READ | PROT_WRITE);
+    mem_touched++;
+    if (base == mem_start_brk)
+    {
+        size_t page = (addr - base) / pagesize;
+        if (page / 8 < sizeof(mem_hit) && !(mem_hit[page / 8] & (1 << page % 8)))
+        {
+            mem_hit[page / 8] |= 1 << page % 8;
+            mem_hit_pages++;
+        }
+    }
+}
+
+/*
+ * mem_protect_maps - set the protection of every live large object mapping
+ */
+static void mem_protect_maps(int prot)
+{
+    for (int i = 0; i < mem_nslots; i++)
+        if (mem_maps[i].addr != NULL)
+            mprotect(mem_maps[i].addr, mem_maps[i].len, prot);
+}
+
+/*
+ * mem_track_begin - start counting the distinct heap pages that are read
+ *    or written. Every heap page is protected and re-enabled on its first
+ *    access, so each page is counted once until mem_track_end. Large
+ *    object mappings, including those made while tracking, are counted
+ *    the same way.
+ */
+void mem_track_begin(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = mem_page_fault;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &mem_old_segv);
+
+    mem_touched = 0;
+    mem_tracking = 1;
+    mprotect(mem_start_brk, MAX_HEAP, PROT_NONE);
+    mem_protect_maps(PROT_NONE);
+}
+
+/*
+ * mem_track_end - stop page tracking and return the number of distinct
+ *    heap pages touched since mem_track_begin.
+ */
+size_t mem_track_end(void)
+{
+    mprotect(mem_start_brk, MAX_HEAP, PROT_READ | PROT_WRITE);
+    mem_protect_maps(PROT_READ | PROT_WRITE);
+    mem_tracking = 0;
+    sigaction(SIGSEGV, &mem_old_segv, NULL);
+    return mem_touched;
+}
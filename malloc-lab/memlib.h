@@ -8,4 +8,20 @@ void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
 size_t mem_pagesize(void);
+size_t mem_peaksize(void);
+
+/* large objects mapped outside the brk heap */
+void *mem_map(size_t len, int *slot);
+void *mem_remap(int slot, size_t new_len);
+void mem_unmap(int slot);
+int mem_map_slot(const void *p, size_t *offset);
+int mem_in_map(void *lo, void *hi);
+size_t mem_mapsize(void);
+
+/* page residency / working-set measurement (mdriver -p) */
+void mem_release_pages(void);
+size_t mem_resident_pages(void);
+size_t mem_touched_pages(void);
+void mem_track_begin(void);
+size_t mem_track_end(void);
 
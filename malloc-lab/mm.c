@@ -9,11 +9,12 @@
  * -----------------------------------------------------
  *
  * [비어있는 블록 (최소 24B)]
- * -----------------------------------------------------------------
- * | header (4B) | prev_ptr (8B) | next_ptr (8B) | ... | footer (4B) |
- * -----------------------------------------------------------------
- * - 비어있는 블록의 payload 영역은 'prev_ptr'과 'next_ptr' 포인터(총 16B)로 사용됨.
- * - Header(4B) + Pointers(16B) + Footer(4B) = 최소 24 바이트.
+ * ------------------------------------------------------------------------------
+ * | header (4B) | next_off (4B) | size (4B) | prev_ptr (8B) | ... | footer (4B) |
+ * ------------------------------------------------------------------------------
+ * - 비어있는 블록의 payload 앞 16B는 리스트 노드: 다음 블록의 오프셋, 크기 사본, 이전 블록 포인터.
+ * - find_fit이 노드마다 읽는 (크기, 다음) 두 값이 8바이트 정렬된 한 워드에 있음.
+ * - Header(4B) + Node(16B) + Footer(4B) = 최소 24 바이트.
  *
  * --- 핵심 로직 (Segregated Best-Fit) ---
  * - 힙은 여러 개의 '크기 클래스(Size Class)'로 나뉜 빈 블록 리스트를 가짐
@@ -37,7 +38,44 @@
 #include <string.h>
 #include <stdint.h>
 #include "mm.h"
+#include "mm_fast.h"
 #include "memlib.h"
+#include "mm_classes.h"
+#ifdef MM_CACHESIM
+#include "cachesim.h"
+#endif
+#ifdef MM_PROFILE
+#include <math.h>
+#include <execinfo.h>
+#endif
+#ifdef MM_THREADS
+#include <pthread.h>
+#include <time.h>
+#if defined(MM_PERCPU) && defined(__x86_64__) && defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define MM_HAVE_RSEQ 1
+#endif
+#endif
+#endif
+#ifdef MM_STATS
+#include <time.h>
+#endif
+#ifdef MM_REGIONS
+#include "config.h" /* MAX_HEAP */
+#endif
+/* x86에서는 큰 realloc 복사에 스트리밍 저장(non-temporal store) 커널을 씀 (mm_init에서 AVX2/SSE2 선택) */
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(MM_NO_NT_COPY)
+#include <immintrin.h>
+#define MM_NT_COPY 1
+#endif
+/* USDT 프로브: <sys/sdt.h>(systemtap-sdt-dev)가 있으면 기본으로 켜짐. -DMM_NO_USDT로 끌 수 있음 */
+#if !defined(MM_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MM_USDT 1
+#endif
+#endif
 
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
@@ -65,9 +103,146 @@ team_t team = {
 #define WSIZE 4
 /* 2 워드(Double Word) 크기, 정렬 단위 (8바이트) */
 #define DSIZE 8
-/* 힙을 확장할 때 사용할 기본 크기 (4KB) */
+/* 힙을 확장할 때 사용할 기본(최소) 크기 (4KB). 실제 확장 단위는 grow_policy가 정함 */
 #define CHUNKSIZE (1 << 12)
 
+/*
+ * --- 캐시 시뮬레이터 계측 (make mdriver-cachesim, -DMM_CACHESIM) ---
+ * SIM(p, n): 메타데이터 접근 주소 p(n바이트)를 캐시/TLB 모델에 보고하고 p를 그대로 반환.
+ * SIM_FUNC(fn): 현재 함수가 끝날 때까지의 접근을 fn으로 집계 (스코프를 벗어나면 자동 복원).
+ * 계측을 끄면 둘 다 아무 코드도 만들지 않음.
+ */
+#ifdef MM_CACHESIM
+#define SIM(p, n) cachesim_access((p), (n))
+#define SIM_FUNC(fn) int sim_saved_ __attribute__((cleanup(cachesim_leave))) = cachesim_enter(fn)
+#else
+#define SIM(p, n) (p)
+#define SIM_FUNC(fn)
+#endif
+
+/*
+ * --- 내부 카운터 (make mdriver-stats, -DMM_STATS) ---
+ * STAT_INC/STAT_ADD: mm_stats의 카운터를 증가. MM_STATS가 없으면 아무 코드도 만들지 않음.
+ * 카운터 값은 mm_ctl("stats.find_fit.visits", &v) 형태로 조회.
+ */
+#ifdef MM_STATS
+#define STAT_INC(field) (mm_stats.field++)
+#define STAT_ADD(field, n) (mm_stats.field += (n))
+#else
+#define STAT_INC(field)
+#define STAT_ADD(field, n)
+#endif
+
+/*
+ * --- 샘플링 힙 프로파일러 (make mdriver-prof, -DMM_PROFILE) ---
+ * PROF_MALLOC: 평균 PROF_SAMPLE_BYTES 바이트마다 한 번 꼴로 할당을 샘플링 (기하 분포 간격).
+ * PROF_FREE: 샘플링된 블록(헤더의 PROF_BIT)이 해제되면 해당 사이트의 live 바이트를 차감.
+ * 샘플링되지 않은 할당/해제는 카운터 뺄셈 한 번, 비트 검사 한 번만 추가됨.
+ */
+#ifdef MM_PROFILE
+#define PROF_MALLOC(bp, size)                        \
+    do                                               \
+    {                                                \
+        if ((prof_countdown -= (long)(size)) <= 0)   \
+            prof_sample(bp, size);                   \
+    } while (0)
+#define PROF_FREE(bp)                                \
+    do                                               \
+    {                                                \
+        if (GET(HDRP(bp)) & PROF_BIT)                \
+            prof_unsample(bp);                       \
+    } while (0)
+#else
+#define PROF_MALLOC(bp, size)
+#define PROF_FREE(bp)
+#endif
+
+/*
+ * --- USDT 정적 트레이스포인트 (provider "mm") ---
+ * 프로브는 붙이기 전까지 nop 한 개이므로 기본 빌드에 그대로 둠. 다시 빌드하지 않고
+ * perf probe / bpftrace로 실행 중인 프로세스에 붙일 수 있음. 예)
+ *   bpftrace -e 'usdt:./mdriver:mm:find_fit_miss { @[arg0] = count(); }'
+ * 프로브 목록(인자):
+ *   malloc_entry(size)  malloc_exit(bp, size)  find_fit_miss(asize)
+ *   extend_heap(bytes, bp)  coalesce(case 1~4, 병합 후 size)
+ *   realloc_inplace(ptr, size)  realloc_move(oldptr, newptr, 복사한 바이트)
+ */
+#ifdef MM_USDT
+#define PROBE1(name, a) STAP_PROBE1(mm, name, a)
+#define PROBE2(name, a, b) STAP_PROBE2(mm, name, a, b)
+#define PROBE3(name, a, b, c) STAP_PROBE3(mm, name, a, b, c)
+#else
+#define PROBE1(name, a)
+#define PROBE2(name, a, b)
+#define PROBE3(name, a, b, c)
+#endif
+
+/*
+ * --- 멀티스레드 빌드 (make mtbench, -DMM_THREADS) ---
+ * seg_list_roots를 건드리는 경로(seg_malloc/seg_free/seg_realloc)는 전역 뮤텍스 mm_lock 안에서만 실행.
+ * 병합하지 않는 작은 블록(크기 LF_MAX_SIZE 이하)은 크기별 lock-free Treiber 스택으로 재사용하므로
+ * 이 크기들의 malloc/free는 스택이 비어 있을 때만 잠금을 거침.
+ * -DMM_NO_LOCKFREE를 같이 주면 스택 없이 모든 호출이 잠금을 거침 (mtbench-locked, 비교용).
+ * mm_fast.h의 캐시와 프로파일러는 스레드 안전하지 않으므로 이 빌드에서 쓰지 않음.
+ *
+ * --- 스레드별 페이지 모드 (make mtbench-sharded / mdriver-sharded, -DMM_THREADS -DMM_SHARDED) ---
+ * mimalloc처럼 작은 객체(SHARD_MAX_SIZE 이하)를 스레드별 페이지에 둠. 페이지는 seg_malloc으로 받은
+ * 블록 하나이고(작게 시작해 SHARD_PAGE_SIZE까지 두 배씩, shard_page_new), 한 크기의 슬롯으로 나뉨. 페이지마다 free list가 두 개:
+ *   free        - 소유 스레드만 push/pop (같은 스레드 해제는 포인터 push 한 번)
+ *   thread_free - 다른 스레드가 CAS로 push. 소유 스레드가 할당하다 free가 비면 통째로 가져옴
+ * 전역 잠금은 페이지를 새로 받거나 돌려줄 때만 잡음. Treiber 스택은 쓰지 않음.
+ * 소유자는 스레드마다 새로 받는 번호(TLS 주소는 끝난 스레드의 것을 새 스레드가 물려받을 수 있음).
+ * 스레드가 끝나면(shard_key 소멸자) 빈 페이지는 seg 힙에 돌려주고, 객체가 남은 페이지는
+ * 버려진(abandoned) 페이지로 클래스별 리스트에 올림. 그 크기의 페이지가 필요한 다른 스레드가
+ * 새 페이지를 만들기 전에 넘겨받음 (그동안의 해제는 thread_free에 쌓임).
+ *
+ * --- 스레드 캐시 + 중앙 전달 캐시 모드 (make mtbench-tcache, -DMM_THREADS -DMM_TCACHE) ---
+ * tcmalloc처럼 작은 블록(LF_MAX_SIZE 이하)을 스레드별 크기 리스트에 캐시. 리스트가 비면 중앙
+ * 전달 캐시에서 배치(batch) 하나를 통째로 받고, 너무 길어지면 배치 하나를 떼어 돌려줌.
+ * 전달 캐시는 Treiber 스택에 객체 대신 배치를 쌓은 것. 전달 캐시도 비었을 때만 잠금을 잡고
+ * seg 힙에서 배치 하나를 한꺼번에 할당함. 배치 크기는 클래스별로 적응:
+ * seg 힙까지 내려가면 두 배로 (TC_MAX_BATCH까지), 전달 캐시가 넘쳐 seg 힙에 돌려주면 절반으로.
+ * 생산자/소비자 패턴에서 소비자가 해제한 블록은 배치 단위로 생산자에게 넘어가므로
+ * 객체마다 seg 힙을 부르지 않음.
+ *
+ * --- CPU별 캐시 모드 (make mtbench-percpu, -DMM_THREADS -DMM_TCACHE -DMM_PERCPU) ---
+ * 스레드 캐시 대신 CPU별 슬랩(클래스별 포인터 배열 + 길이)을 둠. push/pop은 Linux rseq 임계 구역이라
+ * 잠금도 CAS도 없이 현재 CPU의 슬랩만 고치고, 중간에 선점/CPU 이동이 일어나면 커널이 처음부터
+ * 다시 시작시킴. 캐시 메모리가 스레드 수가 아니라 코어 수에 비례함. 슬랩이 비거나 차면 위와 같은
+ * 전달 캐시와 배치를 주고받음. glibc가 rseq를 등록하지 못했으면(커널 미지원, GLIBC_TUNABLES로 끔)
+ * 스레드 캐시로 동작.
+ *
+ * --- 잠금 경합 프로파일링 (make mdriver-lockprof / mtbench-lockprof, -DMM_THREADS -DMM_LOCKPROF) ---
+ * 모든 MM_LOCK이 먼저 trylock을 해 보고, 실패하면(경합) 기다린 시간을 잼. 잠금별로
+ * 획득 수, 경합 수, 대기 시간 합/최대, log2(ns) 대기 시간 히스토그램, 그리고 잠금을 잡은
+ * 함수(MM_LOCK을 부른 함수)별 획득 수와 그 함수가 잡고 있는 동안 다른 스레드가 기다린 횟수/시간을 셈.
+ * mm_ctl("lock.heap.contended") 등으로 조회하고, mm_lock_report가 표로 출력. mm_init마다 0으로.
+ * 경합하지 않은 획득의 추가 비용은 trylock 한 번과 카운터 몇 개 (잠금 안에서 갱신하므로 원자 연산 없음).
+ */
+#ifdef MM_THREADS
+#ifdef MM_LOCKPROF
+#define MM_LOCK() lock_acquire(&mm_lock, &mm_lock_prof, __func__)
+#define MM_UNLOCK() lock_release(&mm_lock, &mm_lock_prof)
+#else
+#define MM_LOCK() pthread_mutex_lock(&mm_lock)
+#define MM_UNLOCK() pthread_mutex_unlock(&mm_lock)
+#endif
+#if !defined(MM_NO_LOCKFREE) && !defined(MM_SHARDED)
+#define MM_LOCKFREE 1
+#endif
+#if defined(MM_TCACHE) && !defined(MM_LOCKFREE)
+#error "MM_TCACHE needs the lock-free stacks (no MM_NO_LOCKFREE / MM_SHARDED)"
+#endif
+/* rseq 임계 구역은 x86-64 어셈블리이고 glibc 2.35+의 rseq 등록을 씀. 그 밖에서는 스레드 캐시만 */
+#if defined(MM_PERCPU) && !(defined(MM_TCACHE) && defined(MM_HAVE_RSEQ))
+#undef MM_PERCPU
+#endif
+#else
+#undef MM_LOCKPROF /* 잠금이 없는 단일 스레드 빌드에서는 의미 없음 */
+#define MM_LOCK()
+#define MM_UNLOCK()
+#endif
+
 /* 두 값 중 큰 값을 반환 (realloc에서 힙 확장 크기 결정 시 사용) */
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 
@@ -75,14 +250,36 @@ team_t team = {
 #define PACK(size, alloc) ((size) | (alloc))
 
 /* 주소 p에서 4바이트(1 워드) 값을 읽어옴. (void *)를 역참조하기 위해 캐스팅 */
-#define GET(p) (*(unsigned int *)(p))
+#define GET(p) (*(unsigned int *)SIM(p, WSIZE))
 /* 주소 p에 4바이트 값(val)을 씀 */
-#define PUT(p, val) (*(unsigned int *)(p) = (val))
+#define PUT(p, val) (*(unsigned int *)SIM(p, WSIZE) = (val))
 
 /* 주소 p(헤더/푸터)에서 '크기' 정보만 추출. (하위 3비트를 0으로 만듦) */
 #define GET_SIZE(p) (GET(p) & ~0x7)
 /* 주소 p(헤더/푸터)에서 '할당 비트'(0x1)만 추출 */
 #define GET_ALLOC(p) (GET(p) & 0x1)
+/* 할당된 블록 헤더의 '샘플링됨' 비트 (프로파일러 전용, 크기가 8의 배수라 하위 비트가 비어 있음) */
+#define PROF_BIT 0x2
+/* 핸들 블록(mm_halloc) 헤더의 '옮길 수 있음' 비트. seg 블록 헤더에만 쓰므로 페이지 객체의 SHARD_BIT와 겹치지 않음 */
+#define HANDLE_BIT 0x4
+/*
+ * 큰 객체(LARGE_MIN 바이트 이상)는 힙 밖에 따로 매핑(mem_map)하고, realloc은 mremap으로 페이지째 옮김.
+ * 매핑 맨 앞 [매핑 길이 8B][memlib 슬롯 번호 4B][헤더 4B] 뒤가 payload (16B 정렬).
+ * 슬롯 번호 덕분에 memlib이 해제/mremap할 때 매핑 목록을 뒤지지 않음.
+ * 헤더 값 LARGE_HDR(크기 0 + 하위 비트 모두)은 일반 블록/페이지 객체/핸들 블록 헤더로는 나올 수 없는 값이라
+ * mm_free/mm_realloc이 헤더 하나로 구분함. 프로파일러 샘플링 대상은 아님.
+ * 매핑 목록(MAX_MAPS)이 차면 큰 요청도 seg 힙에서 할당함 (그 블록은 일반 블록이라 seg_*로 해제/변경).
+ */
+#ifndef LARGE_MIN
+#define LARGE_MIN (128 * 1024)
+#endif
+#define LARGE_HDR 0x7
+#define LARGE_PREFIX (2 * DSIZE)
+/* size 바이트 payload에 필요한 매핑 길이 (페이지 단위로 올림) */
+#define LARGE_ROUND(size) (((size) + LARGE_PREFIX + mem_pagesize() - 1) & ~(mem_pagesize() - 1))
+#define LARGE_LEN(bp) (*(size_t *)SIM((char *)(bp) - LARGE_PREFIX, DSIZE))
+#define LARGE_SLOT(bp) (*(int *)SIM((char *)(bp) - LARGE_PREFIX + DSIZE, WSIZE))
+#define IS_LARGE(bp) (GET(HDRP(bp)) == LARGE_HDR)
 
 /*
  * bp(Block Pointer)는 *페이로드*의 시작 주소를 가리킴.
@@ -110,101 +307,488 @@ team_t team = {
 /* --- NEW: Segregated List를 위한 매크로 및 상수 --- */
 
 /*
- * 64비트 환경이므로 포인터는 8바이트(DSIZE).
- * '빈 블록'의 페이로드 시작 주소(bp)에 '이전 빈 블록'의 포인터를 저장/로드.
+ * 빈 블록 노드 (payload 앞 16바이트).
+ * find_fit은 노드마다 크기와 다음 링크만 읽으므로 둘을 payload 첫 8바이트(정렬된 한 워드)에 모음:
+ * 다음 링크는 힙 시작(heap_listp) 기준 4바이트 오프셋(0이면 끝), 크기는 헤더 값의 사본.
+ * 헤더(bp - 4)까지 읽으면 bp가 라인의 시작일 때 라인 두 개를 건드리지만 이 워드는 항상 한 라인 안에 있음.
+ * 크기 사본은 insert_into_list가 쓰고, 리스트에 든 동안에는 크기가 바뀌지 않음 (바꾸는 곳은 모두 먼저 remove_from_list).
+ * wilderness는 리스트에 들지 않으므로 사본이 없음.
+ * 이전 링크는 제거할 때만 쓰므로 뒤 8바이트에 포인터로 둠.
  */
-#define GET_PREV_FREE(bp) (*(void **)(bp))
-#define SET_PREV_FREE(bp, ptr) (*(void **)(bp) = (ptr))
+#define NODE_NEXT(bp) (*(unsigned int *)SIM(bp, WSIZE))
+#define NODE_SIZE(bp) (*(unsigned int *)SIM((char *)(bp) + WSIZE, WSIZE))
+#define GET_NEXT_FREE(bp) node_next(bp)
+#define SET_NEXT_FREE(bp, ptr) (NODE_NEXT(bp) = (ptr) ? (unsigned int)((char *)(ptr) - heap_listp) : 0)
+#define GET_PREV_FREE(bp) (*(void **)SIM((char *)(bp) + DSIZE, DSIZE))
+#define SET_PREV_FREE(bp, ptr) (*(void **)SIM((char *)(bp) + DSIZE, DSIZE) = (ptr))
 /*
- * '빈 블록'의 페이로드 시작 주소(bp) + 8바이트 위치에 '다음 빈 블록'의 포인터를 저장/로드.
+ * 리스트를 따라갈 때 다음 노드를 미리 캐시로 가져옴 (현재 노드를 비교하는 동안 겹쳐서 읽도록).
+ * 캐시 시뮬레이터 빌드에서는 요구 접근과 따로 집계함.
  */
-#define GET_NEXT_FREE(bp) (*(void **)((char *)(bp) + DSIZE))
-#define SET_NEXT_FREE(bp, ptr) (*(void **)((char *)(bp) + DSIZE) = (ptr))
+#ifdef MM_CACHESIM
+#define PREFETCH_NODE(bp) cachesim_prefetch((bp), DSIZE)
+#else
+#define PREFETCH_NODE(bp) __builtin_prefetch(bp)
+#endif
 
 /*
- * 크기 클래스(버킷)의 총 개수. (0 ~ 9)
+ * 크기 클래스(버킷)의 총 개수와 경계는 mm_classes.h(MM_NUM_CLASSES, MM_CLASS_LIMITS)에서 가져옴.
+ * 튜닝 빌드(-DMM_TUNE_CLASSES, classtune이 사용)에서는 최대 MM_TUNE_MAX_CLASSES개까지의
+ * 경계를 mm_init 때 환경 변수 MM_CLASSES("31,63,...")에서 읽음. 남는 클래스는 항상 비어 있음.
  */
-#define NUM_CLASSES 10
+#ifdef MM_TUNE_CLASSES
+#define MM_TUNE_MAX_CLASSES 32
+#define NUM_CLASSES MM_TUNE_MAX_CLASSES
+#else
+#define NUM_CLASSES MM_NUM_CLASSES
+#endif
+/* i번째 크기 클래스 리스트의 root 포인터 (읽기/쓰기 모두 가능한 lvalue) */
+#define SEG_ROOT(i) (*(void **)SIM(&seg_list_roots[i], DSIZE))
 /* --- NEW --- */
 /* --- 추가 매크로 --- */
 /*
  * 최소 블록 크기 정의.
- * Header(4B) + Prev Ptr(8B) + Next Ptr(8B) + Footer(4B) = 24 바이트.
+ * Header(4B) + Next Off(4B) + Size(4B) + Prev Ptr(8B) + Footer(4B) = 24 바이트.
  */
 #define MIN_BLOCK_SIZE (3 * DSIZE)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 /* --- 전역 변수 --- */
 /* 힙의 시작(패딩)을 가리키는 포인터. mm_init에서만 설정됨. */
 static char *heap_listp = 0;
+/* GET_NEXT_FREE: 다음 링크 오프셋을 한 번만 읽어 포인터로 바꿈 (0이면 NULL) */
+static inline void *node_next(void *bp)
+{
+    unsigned int off = NODE_NEXT(bp);
+    return off ? heap_listp + off : NULL;
+}
 /*
- * Segregated List의 각 크기 클래스(총 10개)의 시작(root)을 가리키는 포인터 배열.
- * seg_list_roots[0]는 24-31B 크기 리스트의 첫 번째 빈 블록을 가리킴.
+ * Segregated List의 각 크기 클래스(총 NUM_CLASSES개)의 시작(root)을 가리키는 포인터 배열.
+ * 기본 표에서 seg_list_roots[0]는 24-31B 크기 리스트의 첫 번째 빈 블록을 가리킴.
  * seg_list_roots[1]는 32-63B 크기 리스트의 첫 번째 빈 블록을 가리킴. ...
  */
 static void *seg_list_roots[NUM_CLASSES];
+/*
+ * 지정 희생 블록 (designated victim, dlmalloc의 dv).
+ * 작은 요청(DV_MAX 이하)이 큰 빈 블록을 분할하고 남은 나머지. 리스트에도 그대로 들어 있고,
+ * 리스트에서 빠지는 순간(할당, 병합, 분할) remove_from_list가 NULL로 지움.
+ * 작은 요청은 크기가 딱 맞는 빈 블록이 없으면 best-fit 대신 dv의 앞부분을 잘라 씀.
+ * 그래서 연달아 할당한 작은 객체들이 메모리에서도 이웃하게 됨.
+ */
+#define DV_MAX 256
+static char *dv_bp;
+/*
+ * wilderness (dlmalloc의 top): 에필로그 바로 앞의 빈 블록. 크기 클래스 리스트에 넣지 않고 따로 가짐.
+ * insert_into_list가 힙 끝(brk)에서 끝나는 블록을 여기로 돌리고 remove_from_list가 지우므로,
+ * 병합/분할/확장/축소 코드는 따로 신경 쓰지 않아도 됨.
+ * 리스트에 맞는 블록이 없을 때만 여기서 앞부분을 잘라 줌 (O(1)). 모자라면 힙을 늘림 (grow_policy).
+ */
+static char *wild_bp;
+/*
+ * 힙 확장 단위 (grow_chunk). 확장할 때마다 직전 청크가 malloc 몇 번 만에 소진됐는지로 최근 증가 속도를 재고,
+ * 다음 청크가 malloc GROW_WINDOW번쯤 버티도록 맞춤 (한 번에 최대 두 배까지 키우고, 느려지면 바로 줄임).
+ * 피크에서 힙 끝에 남는 빈 공간(이용률 손실)을 제한하기 위해 힙 크기의 1/MM_GROW_RATIO를 넘기지 않음
+ * (-DMM_GROW_RATIO=n으로 바꿀 수 있음. 기본 64면 512KB 미만의 힙은 CHUNKSIZE씩만 늘어남).
+ * trim_heap이 힙을 줄이면 다시 CHUNKSIZE부터 시작함.
+ */
+#ifndef MM_GROW_RATIO
+#define MM_GROW_RATIO 64
+#endif
+#define GROW_WINDOW 1024 /* 청크 하나가 버텨야 할 malloc 횟수 */
+static size_t grow_chunk;          /* 다음 확장 크기 */
+static size_t grow_last;           /* 마지막 확장 크기 */
+static unsigned long grow_mallocs; /* 마지막 확장 이후의 seg_malloc 호출 수 */
+#ifdef MM_BOUNDARY
+/*
+ * 경계 인식 배치 (-DMM_BOUNDARY). payload가 캐시 라인 이하인 블록은 라인 경계를, 페이지 이하인 블록은
+ * 페이지 경계를 걸치지 않게 place가 빈 블록 안쪽으로 옮겨 놓음 (boundary_lead).
+ * 한 번의 접근이 라인/페이지 두 개를 건드리는 일을 줄이는 대신 앞 조각만큼 단편화가 생김.
+ */
+#define BOUNDARY_LINE 64
+#define BOUNDARY_PAGE 4096
+#endif
+/*
+ * mm_fast.h의 인라인 fast path가 쓰는 크기 클래스별 캐시 (payload 8바이트 단위).
+ * 캐시에 든 블록은 헤더상 '할당됨' 상태이고 payload 첫 8바이트에 다음 블록 포인터를 둠.
+ * 힙이 새로 만들어지므로 mm_init에서 비움.
+ */
+void *mm_fast_cache[MM_FAST_CLASSES];
+unsigned int mm_fast_count[MM_FAST_CLASSES];
+/*
+ * 핸들 테이블 (mm_halloc). 0번은 무효 핸들이고, 빈 항목은 next_free로 연결됨.
+ * 핸들 블록은 payload 첫 8바이트에 자기 핸들 번호를 두고 사용자에게는 그 뒤를 넘김.
+ * 압축기가 블록을 옮긴 뒤 이 번호로 테이블을 고침.
+ */
+#define MAX_HANDLES (1 << 16)
+static struct
+{
+    char *bp;               /* 핸들 블록의 bp (NULL이면 빈 항목) */
+    unsigned int pins;      /* mm_hpin 중첩 횟수. 0일 때만 옮길 수 있음 */
+    unsigned int next_free; /* 빈 항목 리스트의 다음 번호 */
+} handles[MAX_HANDLES];
+static unsigned int handle_free; /* 빈 항목 리스트의 head (0이면 없음) */
+static unsigned int handle_top;  /* 아직 한 번도 쓰지 않은 첫 번호 */
+/*
+ * 점진적 압축(mm_compact)의 진행 위치. 블록이 병합되거나 옮겨지면(seg_free, seg_realloc)
+ * heap_gen이 바뀌어 compact_bp가 블록 중간을 가리킬 수 있으므로 그때는 힙 처음부터 다시 훑음.
+ */
+static char *compact_bp;
+static unsigned long compact_gen;
+static unsigned long heap_gen;
+static size_t trim_brk;        /* 마지막으로 자른 뒤의 힙 크기 (0이면 아직 자른 적 없음) */
+static unsigned int trim_wait; /* 다음 자르기 전에 기다릴 압축 바퀴 수 */
+static unsigned int trim_passes;
+static struct
+{
+    unsigned long live;          /* 살아있는 핸들 수 */
+    unsigned long moves;         /* 압축기가 옮긴 블록 수 */
+    unsigned long moved_bytes;   /* 압축기가 옮긴 총 바이트 */
+    unsigned long trimmed_bytes; /* 힙 끝을 잘라 돌려준 총 바이트 */
+} compact_stats;
+
+#ifdef MM_THREADS
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+#ifdef MM_LOCKPROF
+#define LOCK_HIST_BUCKETS 32 /* 대기 시간 히스토그램: 버킷 i = [2^i, 2^(i+1)) ns */
+#define LOCK_MAX_HOLDERS 16  /* 잠금별로 구분해 셀 최대 함수 수 */
+
+/* 잠금을 잡은 함수 하나의 기록 */
+typedef struct
+{
+    const char *func;         /* MM_LOCK을 부른 함수 (__func__) */
+    unsigned long acquisitions;
+    unsigned long blocked;    /* 이 함수가 잡고 있어서 다른 스레드가 기다린 횟수 */
+    unsigned long blocked_ns; /* 그 대기 시간의 합 */
+} lock_holder_t;
+
+/* 잠금 하나의 경합 기록. holder 외의 필드는 잠금을 잡은 상태에서만 고침 */
+typedef struct
+{
+    const char *name;   /* mm_ctl 이름의 lock.<name>. */
+    const char *holder; /* 지금 잡고 있는 함수 (atomic, 경합 시 기다리는 쪽이 읽음) */
+    unsigned long acquisitions;
+    unsigned long contended;
+    unsigned long wait_ns;
+    unsigned long max_wait_ns;
+    unsigned long wait_hist[LOCK_HIST_BUCKETS];
+    lock_holder_t holders[LOCK_MAX_HOLDERS];
+} lock_prof_t;
+
+static lock_prof_t mm_lock_prof = {.name = "heap"};
+/* mm_ctl/mm_lock_report가 보여 줄 잠금 목록 */
+static lock_prof_t *const lock_profs[] = {&mm_lock_prof};
+#define NUM_LOCKS ((int)(sizeof(lock_profs) / sizeof(lock_profs[0])))
+#endif
+/* mm_init마다 1씩 증가. 스레드별 상태(캐시/페이지)는 자기 epoch가 다르면 예전 힙의 것이므로 버림 */
+static unsigned long heap_epoch;
+#endif
+#ifdef MM_LOCKFREE
+/* lock-free 스택으로 관리할 최대 블록 크기. 24, 32, ..., 128B가 각각 하나의 정확한 크기 클래스 */
+#define LF_MAX_SIZE 128
+#define LF_CLASSES (LF_MAX_SIZE / DSIZE + 1)
+/*
+ * 크기별 Treiber 스택의 head (인덱스 = 블록 크기 / 8).
+ * 하위 32비트: mem_heap_lo() 기준 top 블록의 오프셋 (0이면 빈 스택. 힙은 4GB보다 작음)
+ * 상위 32비트: push/pop마다 1씩 늘어나는 세대 번호. 128비트 CAS 없이 64비트 CAS 하나로 ABA를 막음.
+ * 스택에 든 블록은 헤더상 '할당됨'이라 병합되지 않고, payload 첫 4바이트에 다음 블록의 오프셋을 둠.
+ */
+static uint64_t lf_heads[LF_CLASSES];
+static char *lf_base; /* 오프셋의 기준 주소 (mem_heap_lo) */
+#endif
+#ifdef MM_TCACHE
+#define TC_MIN_BATCH 8     /* 배치 크기의 초기값/최소값 */
+#define TC_MAX_BATCH 64    /* 배치 크기의 최대값 */
+#define TC_MAX_BATCHES 64  /* 클래스별로 전달 캐시에 쌓아 둘 최대 배치 수 */
+/*
+ * 캐시된 블록의 payload: [0, 4) 전달 캐시 스택 링크 (배치 head만), [4, 8) 배치의 블록 수 (배치 head만),
+ * [8, 16) 같은 리스트/배치의 다음 블록 포인터. 최소 블록(24B)의 payload는 16B이므로 모두 들어감.
+ */
+#define TC_NEXT(bp) (*(void **)((char *)(bp) + DSIZE))
+#define TC_COUNT(bp) (*(uint32_t *)((char *)(bp) + WSIZE))
+
+/* 스레드 캐시의 크기 리스트 하나 */
+typedef struct
+{
+    void *head;
+    unsigned int count;
+} tc_list_t;
+
+static __thread struct
+{
+    unsigned long epoch; /* heap_epoch와 다르면 예전 힙의 것이므로 비움 */
+    int registered;      /* 스레드 종료 시 캐시를 비우도록 tc_key를 설정했는지 */
+    tc_list_t lists[LF_CLASSES];
+} tcache;
+
+static unsigned int tc_batch[LF_CLASSES];    /* 클래스별 현재 배치 크기 (atomic) */
+static unsigned int tc_batches[LF_CLASSES];  /* 클래스별 전달 캐시의 배치 수 (atomic, 근사값) */
+static pthread_key_t tc_key;
+static pthread_once_t tc_key_once = PTHREAD_ONCE_INIT;
+#endif
+#ifdef MM_PERCPU
+#define PC_MAX_CPUS 256 /* 이보다 번호가 큰 CPU에서는 스레드 캐시를 씀 */
+#define PC_CAP 32       /* CPU별, 클래스별 최대 캐시 블록 수 */
+/* CPU별 슬랩의 길이. 다른 CPU와 같은 캐시 라인을 쓰지 않도록 128바이트 정렬 */
+static struct
+{
+    uint32_t len[LF_CLASSES];
+} __attribute__((aligned(128))) pc_len[PC_MAX_CPUS];
+static void *pc_slots[PC_MAX_CPUS][LF_CLASSES][PC_CAP]; /* CPU별 슬랩 (스택, [0, len)이 유효) */
+static int pc_enabled; /* glibc가 rseq를 등록했는지 (mm_init에서 확인) */
+#endif
+#ifdef MM_SHARDED
+#define SHARD_PAGE_SIZE 4096 /* 페이지 하나의 최대 블록 크기 (seg 블록 헤더/푸터 포함) */
+#ifndef SHARD_PAGE_MIN
+#define SHARD_PAGE_MIN 256 /* 스레드가 한 크기에서 처음 받는 페이지의 최소 블록 크기 */
+#endif
+#define SHARD_FIRST_SLOTS 4 /* 처음 받는 페이지가 담을 최소 슬롯 수 */
+#define SHARD_MAX_SIZE 124   /* 페이지에서 할당할 최대 요청 크기 (슬롯 128B) */
+#define SHARD_CLASSES ((SHARD_MAX_SIZE + WSIZE) / DSIZE + 1)
+/*
+ * 페이지 객체의 4바이트 헤더 = (페이지 시작부터 payload까지의 바이트 오프셋) | SHARD_BIT | 1.
+ * 일반 블록 헤더는 이 비트가 항상 0이므로 mm_free/mm_realloc이 헤더 하나로 구분함.
+ * 슬롯 간격이 8의 배수이고 payload 앞 4바이트가 헤더라 객체당 오버헤드는 4바이트.
+ */
+#define SHARD_BIT 0x4
+
+#define SHARD_ABANDONED (~0UL) /* 소유 스레드가 끝난 페이지의 owner */
+
+/* 페이지 헤더 (seg 블록 payload의 맨 앞) */
+typedef struct shard_page
+{
+    struct shard_page *prev, *next; /* 같은 스레드(또는 버려진 페이지), 같은 크기의 페이지 리스트 */
+    unsigned long owner;            /* 소유 스레드 번호 (atomic, SHARD_ABANDONED면 주인 없음) */
+    void *free;                     /* 로컬 free list (소유 스레드 전용) */
+    void *thread_free;              /* 다른 스레드가 해제한 객체 (atomic push, 통째로 수거) */
+    unsigned int block_size;        /* 슬롯 간격 (헤더 4B 포함) */
+    unsigned int used;              /* 나가 있는 객체 수 (thread_free에 있는 것 포함) */
+} shard_page_t;
+
+/* 스레드별 상태. epoch가 heap_epoch와 다르면 예전 힙의 것이므로 비움 */
+typedef struct shard_tls
+{
+    unsigned long epoch;
+    unsigned long id;                   /* 스레드 번호 (1부터, 0이면 아직 할당한 적 없음) */
+    int registered;                     /* 스레드 종료 시 페이지를 정리하도록 shard_key를 설정했는지 */
+    shard_page_t *pages[SHARD_CLASSES]; /* 슬롯 크기 / 8 -> 페이지 리스트 (head에서 할당) */
+} shard_tls_t;
+
+static __thread shard_tls_t shard_tls;
+static unsigned long shard_next_id;                  /* 마지막으로 나눠 준 스레드 번호 (atomic) */
+static shard_page_t *shard_abandoned[SHARD_CLASSES]; /* 버려진 페이지 (mm_lock으로 보호) */
+static pthread_key_t shard_key;
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+#endif
+#ifdef MM_REGIONS
+/*
+ * 크기 클래스별 전용 영역 (-DMM_REGIONS). REGION_MAX_SIZE 이하 요청은 8바이트 단위 클래스마다
+ * 따로 가진 페이지(span)들에서 슬롯으로 나감. span은 seg 힙 안의 크기 REGION_PAGE인 할당된 블록인데,
+ * payload가 페이지 경계에서 시작하도록 잘라냄. 페이지의 마지막 8바이트는 span의 푸터와 다음 블록의
+ * 헤더라서 다음 블록의 payload는 다음 페이지에서 시작하고, 따라서 span 페이지 안에 bp가 있는 블록은
+ * span 객체뿐임. 힙 끝에서 연달아 잘라낸 span들은 빈틈없이 이어짐.
+ * 슬롯에는 헤더가 없고, 객체의 클래스는 주소의 페이지 번호로 region_spans[]에서 찾음
+ * (mm_free/mm_realloc이 헤더를 읽지 않음). 같은 클래스의 객체는 같은 페이지들에 빽빽하게 모임.
+ * 잠금 없는 단일 스레드 빌드 전용이고 프로파일러 샘플링 대상이 아님.
+ */
+#if defined(MM_THREADS) || defined(MM_PROFILE)
+#error "MM_REGIONS is single-threaded and not sampled by the profiler"
+#endif
+#define REGION_PAGE 4096
+#define REGION_PAGES (MAX_HEAP / REGION_PAGE)
+#define REGION_MAX_SIZE 128                          /* 영역에서 할당할 최대 요청 크기 */
+#define REGION_CLASSES (REGION_MAX_SIZE / DSIZE + 1) /* 슬롯 크기 / 8 -> 클래스 */
+
+/* span 정보 (힙 밖 테이블, 페이지 번호로 찾음) */
+typedef struct region_span
+{
+    struct region_span *prev, *next; /* 같은 클래스에서 빈 슬롯이 있는 span 리스트 */
+    char *free;                      /* 해제된 슬롯 리스트 (슬롯 첫 8바이트에 다음 포인터) */
+    unsigned int bump;               /* 아직 한 번도 나가지 않은 첫 슬롯의 오프셋 */
+    unsigned short cls;              /* 슬롯 크기 / 8. 0이면 span이 아닌 페이지 */
+    unsigned short used;             /* 나가 있는 슬롯 수 */
+} region_span_t;
+
+static region_span_t region_spans[REGION_PAGES];
+static region_span_t *region_avail[REGION_CLASSES]; /* 클래스 -> 빈 슬롯이 있는 span 리스트 (head에서 할당) */
+static size_t region_hi;                            /* span이었던 적이 있는 가장 큰 페이지 번호 + 1 */
+static unsigned long region_live;                   /* 살아있는 span 수 */
+
+/* span 정보 s가 가리키는 페이지의 시작 주소 (힙의 처음 heap_listp는 페이지 정렬됨) */
+#define REGION_ADDR(s) (heap_listp + ((s) - region_spans) * REGION_PAGE)
+#define REGION_CAPACITY(cls) ((REGION_PAGE - DSIZE) / ((cls) * DSIZE))
+#endif
+/*
+ * 각 크기 클래스(마지막 제외)에 들어갈 수 있는 최대 블록 크기. 오름차순.
+ * class_limits[i-1] < size <= class_limits[i] 이면 클래스 i, 모두보다 크면 마지막 클래스.
+ */
+#ifdef MM_TUNE_CLASSES
+static size_t class_limits[NUM_CLASSES - 1] = MM_CLASS_LIMITS;
+static void load_class_limits(void);
+#else
+static const size_t class_limits[NUM_CLASSES - 1] = MM_CLASS_LIMITS;
+#endif
+
+#ifdef MM_STATS
+/* 정책 튜닝용 내부 카운터. mm_init마다 0으로 초기화됨. */
+static struct
+{
+    unsigned long mallocs[NUM_CLASSES];  /* 크기 클래스별 mm_malloc 호출 수 */
+    unsigned long frees[NUM_CLASSES];    /* 크기 클래스별 mm_free 호출 수 */
+    unsigned long reallocs[NUM_CLASSES]; /* 크기 클래스별(새 크기 기준) mm_realloc 호출 수 */
+    unsigned long find_fit_calls;        /* find_fit 호출 수 */
+    unsigned long find_fit_visits;       /* find_fit가 방문한 리스트 노드 수 */
+    unsigned long find_fit_misses;       /* 맞는 블록을 못 찾은 횟수 */
+    unsigned long coalesce_cases[4];     /* coalesce Case 1~4 발생 수 */
+    unsigned long place_splits;          /* place에서 분할이 일어난 횟수 */
+    unsigned long dv_hits;               /* dv에서 잘라 준 할당 수 */
+    unsigned long wild_allocs;           /* 리스트에 맞는 블록이 없어 wilderness에서 잘라 준 할당 수 */
+    unsigned long boundary_shifts;       /* 경계를 피해 빈 블록 안쪽으로 옮겨 배치한 수 (MM_BOUNDARY) */
+    unsigned long boundary_lead_bytes;   /* 그때 앞에서 떼어낸 바이트 수 */
+    unsigned long extend_calls;          /* extend_heap 호출 수 */
+    unsigned long extend_bytes;          /* extend_heap으로 늘린 총 바이트 */
+    unsigned long realloc_inplace;       /* 복사 없이 제자리에서 끝난 realloc */
+    unsigned long realloc_move;          /* 이전 블록으로 memmove한 realloc */
+    unsigned long realloc_copy;          /* malloc + memcpy + free로 끝난 realloc */
+    unsigned long realloc_copied_bytes;  /* realloc에서 복사(memmove/memcpy)한 총 바이트 */
+    unsigned long copy_nt_bytes;         /* copy_block(realloc, 압축)이 스트리밍 저장으로 복사한 바이트 */
+    unsigned long copy_ns;               /* copy_block에 걸린 총 시간 (ns) */
+    unsigned long large_maps;            /* 큰 객체 매핑 수 */
+    unsigned long large_remaps;          /* 큰 객체 mremap 수 */
+} mm_stats;
+#endif
+
+#ifdef MM_PROFILE
+/* 샘플링 평균 간격(바이트). tcmalloc처럼 기하 분포로 다음 샘플까지의 거리를 뽑음 */
+#ifndef PROF_SAMPLE_BYTES
+#define PROF_SAMPLE_BYTES (64 * 1024)
+#endif
+#define PROF_MAX_DEPTH 16     /* 사이트당 저장할 최대 스택 깊이 */
+#define PROF_MAX_SITES 1024   /* 할당 사이트 해시 테이블 크기 (2의 거듭제곱) */
+#define PROF_MAX_SAMPLES 8192 /* 살아있는 샘플 블록 해시 테이블 크기 (2의 거듭제곱) */
+
+/* 할당 사이트 (backtrace 또는 mm_prof_set_site로 받은 id) 별 통계 */
+typedef struct
+{
+    int depth;                   /* 0이면 빈 슬롯 */
+    void *stack[PROF_MAX_DEPTH]; /* 호출 스택 (site id 모드에서는 stack[0]에 id) */
+    unsigned long live_objs;     /* 현재 살아있는 샘플 수 */
+    unsigned long live_bytes;    /* 현재 살아있는 샘플 바이트 */
+    unsigned long peak_bytes;    /* live_bytes의 최대값 */
+    unsigned long alloc_objs;    /* 누적 샘플 수 */
+    unsigned long alloc_bytes;   /* 누적 샘플 바이트 */
+} prof_site_t;
+
+/* 살아있는 샘플 블록 하나 (bp == NULL: 빈 슬롯, PROF_TOMBSTONE: 삭제됨) */
+typedef struct
+{
+    void *bp;
+    size_t size; /* 요청 크기(payload) */
+    int site;    /* prof_sites 인덱스 */
+} prof_sample_t;
+
+#define PROF_TOMBSTONE ((void *)1)
+
+static prof_site_t prof_sites[PROF_MAX_SITES];
+static prof_sample_t prof_samples[PROF_MAX_SAMPLES];
+static long prof_countdown;          /* 다음 샘플까지 남은 바이트 */
+static unsigned long prof_rng;       /* xorshift 난수 상태 (재현 가능하도록 mm_init에서 고정) */
+static unsigned long prof_site_id;   /* 0이 아니면 backtrace 대신 이 id를 사이트로 사용 */
+static unsigned long prof_dropped;   /* 테이블이 가득 차서 버린 샘플 수 */
+
+static void prof_reset(void);
+static void prof_sample(void *bp, size_t size);
+static void prof_unsample(void *bp);
+static void *prof_realloc(void *ptr, size_t size);
+#endif
 
 /* --- 함수 프로토타입 --- */
 static void *extend_heap(size_t words);
+static void grow_policy(size_t size);
 static void *coalesce(void *bp);
 static void *find_fit(size_t asize);
-static void place(void *bp, size_t asize);
+static void *place(void *bp, size_t asize);
 static int get_class_index(size_t size);
 static void insert_into_list(void *bp);
 static void remove_from_list(void *bp);
+static void *seg_malloc(size_t size);
+static void seg_free(void *bp);
+static void *seg_realloc(void *ptr, size_t size);
+#ifdef MM_NT_COPY
+static void select_copy_kernel(void);
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*
- * get_class_index - 주어진 size가 속해야 할 리스트의 인덱스(0~9)를 반환
+ * get_class_index - 주어진 size가 속해야 할 리스트의 인덱스(0 ~ NUM_CLASSES-1)를 반환
  * Segregated free list(분리된 빈 블록 리스트)를 사용시,내  빈 블록들을 크기별로 여러 리스트에 나눠 관리
+ * 경계는 class_limits 표(mm_classes.h)를 따름. 기본 표는 24-31, 32-63, ..., 4096-8191, 8192+.
  */
 static int get_class_index(size_t size)
 {
-    /* 크기 클래스 분배 (24가 최소) */
-    /* Class 0: 24-31 */
-    if (size <= 31)
-        return 0;
-    /* Class 1: 32-63 */
-    if (size <= 63)
-        return 1;
-    /* Class 2: 64-127 */
-    if (size <= 127)
-        return 2;
-    /* Class 3: 128-255 */
-    if (size <= 255)
-        return 3;
-    /* Class 4: 256-511 */
-    if (size <= 511)
-        return 4;
-    /* Class 5: 512-1023 */
-    if (size <= 1023)
-        return 5;
-    /* Class 6: 1024-2047 */
-    if (size <= 2047)
-        return 6;
-    /* Class 7: 2048-4095 */
-    if (size <= 4095)
-        return 7;
-    /* Class 8: 4096-8191 */
-    if (size <= 8191)
-        return 8;
-    /* Class 9: 8192+ */
-    return 9;
+    /* 상수 표에 대한 짧은 루프라 컴파일러가 펼쳐서 비교문 몇 개로 만듦 */
+    for (int i = 0; i < NUM_CLASSES - 1; i++)
+    {
+        if (size <= class_limits[i])
+            return i;
+    }
+    return NUM_CLASSES - 1;
+}
+
+#ifdef MM_TUNE_CLASSES
+/*
+ * load_class_limits - 환경 변수 MM_CLASSES("31,63,127,...")에서 클래스 경계를 읽음.
+ * 변수가 없거나 잘못되면 mm_classes.h의 표를 사용. 쓰이지 않는 클래스의 경계는 최대값으로 채움.
+ */
+static void load_class_limits(void)
+{
+    static const size_t defaults[] = MM_CLASS_LIMITS;
+    const char *env = getenv("MM_CLASSES");
+    int n = 0;
+
+    while (env != NULL && *env != '\0' && n < NUM_CLASSES - 1)
+    {
+        char *end;
+        unsigned long limit = strtoul(env, &end, 10);
+        if (end == env || (n > 0 && limit <= class_limits[n - 1]))
+        {
+            n = 0; /* 형식 오류: 기본 표 사용 */
+            break;
+        }
+        class_limits[n++] = limit;
+        env = (*end == ',') ? end + 1 : end;
+    }
+    if (n == 0)
+    {
+        n = sizeof(defaults) / sizeof(defaults[0]);
+        memcpy(class_limits, defaults, sizeof(defaults));
+    }
+    for (int i = n; i < NUM_CLASSES - 1; i++)
+        class_limits[i] = (size_t)-1;
 }
+#endif
 
 /*
  * insert_into_list - 빈 블록(bp)을 알맞은 크기 클래스 리스트의 *맨 앞*에 삽입 (LIFO)
  */
 static void insert_into_list(void *bp)
 {
+    SIM_FUNC(CS_INSERT_INTO_LIST);
+    /* 0. 힙의 마지막 빈 블록은 리스트 대신 wilderness로.
+     *    위치로 판단하므로 뒤 블록 헤더를 아직 안 썼거나 payload에 옛 값이 남아 있어도 틀리지 않음 */
+    if ((char *)bp + GET_SIZE(HDRP(bp)) == (char *)mem_heap_hi() + 1)
+    {
+        wild_bp = bp;
+        return;
+    }
     /* 1. 블록 크기에 맞는 리스트 인덱스 찾기 */
     size_t size = GET_SIZE(HDRP(bp));
     int index = get_class_index(size);
     /* 2. 해당 리스트의 현재 첫 번째 블록(head) 가져오기 */
-    void *head = seg_list_roots[index];
+    void *head = SEG_ROOT(index);
 
     /* 3. bp를 새로운 head로 만들기 (LIFO) */
-    /* 3a. bp의 '다음' 포인터가 '이전 head'를 가리키게 함 */
+    /* 3a. bp의 '다음' 링크가 '이전 head'를 가리키게 하고 크기 사본을 씀 */
     SET_NEXT_FREE(bp, head);
+    NODE_SIZE(bp) = size;
     /* 3b. 만약 '이전 head'가 존재했다면, '이전 head'의 '이전' 포인터가 bp를 가리키게 함 */
     if (head != NULL)
     {
@@ -213,7 +797,7 @@ static void insert_into_list(void *bp)
     /* 3c. bp는 이제 head이므로, '이전' 포인터는 NULL */
     SET_PREV_FREE(bp, NULL);
     /* 3d. 리스트의 루트(시작) 포인터를 bp로 교체 */
-    seg_list_roots[index] = bp;
+    SEG_ROOT(index) = bp;
 }
 
 /*
@@ -221,8 +805,16 @@ static void insert_into_list(void *bp)
  */
 static void remove_from_list(void *bp)
 {
-    /* 1. 블록 크기에 맞는 리스트 인덱스 찾기 */
-    size_t size = GET_SIZE(HDRP(bp));
+    SIM_FUNC(CS_REMOVE_FROM_LIST);
+    if (bp == dv_bp)
+        dv_bp = NULL;
+    if (bp == wild_bp)
+    {
+        wild_bp = NULL;
+        return;
+    }
+    /* 1. 블록 크기에 맞는 리스트 인덱스 찾기 (크기는 노드의 사본으로, 다음 링크와 같은 워드) */
+    size_t size = NODE_SIZE(bp);
     int index = get_class_index(size);
 
     /* 2. bp의 '이전' 빈 블록과 '다음' 빈 블록 포인터 가져오기 */
@@ -233,7 +825,7 @@ static void remove_from_list(void *bp)
     if (prev_free == NULL)
     {
         /* 3a. 리스트의 루트(시작)를 bp의 '다음' 블록으로 변경 */
-        seg_list_roots[index] = next_free;
+        SEG_ROOT(index) = next_free;
     }
     /* 4. bp가 head가 아닐 경우 */
     else
@@ -276,13 +868,74 @@ int mm_init(void)
      * `heap_listp` 자체를 순회 시작점으로 쓰지 않는 한 문제없음.)
      */
 
+#ifdef MM_STATS
+    memset(&mm_stats, 0, sizeof(mm_stats));
+#endif
+#ifdef MM_PROFILE
+    prof_reset();
+#endif
+#ifdef MM_TUNE_CLASSES
+    load_class_limits();
+#endif
+
     /* --- NEW --- */
     /* seg_list_roots 배열의 모든 포인터를 NULL로 초기화 */
     for (int i = 0; i < NUM_CLASSES; i++)
     {
-        seg_list_roots[i] = NULL;
+        SEG_ROOT(i) = NULL;
     }
     /* --- END NEW --- */
+    dv_bp = NULL;
+    wild_bp = NULL;
+    grow_chunk = grow_last = CHUNKSIZE;
+    grow_mallocs = 0;
+#ifdef MM_REGIONS
+    memset(region_spans, 0, region_hi * sizeof(region_span_t));
+    memset(region_avail, 0, sizeof(region_avail));
+    region_hi = 0;
+    region_live = 0;
+#endif
+    memset(mm_fast_cache, 0, sizeof(mm_fast_cache));
+    memset(mm_fast_count, 0, sizeof(mm_fast_count));
+#ifdef MM_NT_COPY
+    select_copy_kernel();
+#endif
+    handle_free = 0;
+    handle_top = 1;
+    compact_bp = NULL;
+    trim_brk = 0;
+    trim_wait = 1;
+    trim_passes = 0;
+    memset(&compact_stats, 0, sizeof(compact_stats));
+#ifdef MM_LOCKFREE
+    memset(lf_heads, 0, sizeof(lf_heads));
+    lf_base = mem_heap_lo();
+#endif
+#ifdef MM_TCACHE
+    for (int i = 0; i < LF_CLASSES; i++)
+    {
+        tc_batch[i] = TC_MIN_BATCH;
+        tc_batches[i] = 0;
+    }
+#endif
+#ifdef MM_PERCPU
+    memset(pc_len, 0, sizeof(pc_len));
+    pc_enabled = (__rseq_size > 0);
+#endif
+#ifdef MM_SHARDED
+    memset(shard_abandoned, 0, sizeof(shard_abandoned));
+#endif
+#ifdef MM_THREADS
+    __atomic_add_fetch(&heap_epoch, 1, __ATOMIC_RELEASE);
+#endif
+#ifdef MM_LOCKPROF
+    for (int i = 0; i < NUM_LOCKS; i++)
+    {
+        const char *lock_name = lock_profs[i]->name;
+        memset(lock_profs[i], 0, sizeof(*lock_profs[i]));
+        lock_profs[i]->name = lock_name;
+    }
+#endif
 
     /* * 힙을 CHUNKSIZE(4KB)만큼 확장하여 첫 번째 빈 블록을 생성.
      * extend_heap은 내부적으로 coalesce와 insert_into_list를 호출함.
@@ -298,6 +951,7 @@ int mm_init(void)
  */
 static void *extend_heap(size_t words)
 {
+    SIM_FUNC(CS_EXTEND_HEAP);
     char *bp;
     size_t size;
 
@@ -310,6 +964,9 @@ static void *extend_heap(size_t words)
     /* 3. mem_sbrk로 힙 확장. bp는 새 블록의 페이로드 시작 주소. */
     if ((long)(bp = mem_sbrk(size)) == -1)
         return NULL; /* 실패 */
+    STAT_INC(extend_calls);
+    STAT_ADD(extend_bytes, size);
+    PROBE2(extend_heap, size, bp);
 
     /* 4. 새 빈 블록의 헤더/푸터 설정 (할당 비트 0) */
     PUT(HDRP(bp), PACK(size, 0));
@@ -328,11 +985,29 @@ static void *extend_heap(size_t words)
     return bp;
 }
 
+/*
+ * grow_policy - seg_malloc이 size 바이트를 확장한 뒤 다음 확장 단위(grow_chunk)를 정함.
+ * 직전 확장(grow_last)이 malloc grow_mallocs번 만에 바닥났으면 같은 속도로 GROW_WINDOW번 버틸 크기를 목표로 함
+ */
+static void grow_policy(size_t size)
+{
+    size_t next = grow_last / (grow_mallocs + 1) * GROW_WINDOW;
+
+    if (next > 2 * grow_chunk)
+        next = 2 * grow_chunk;
+    if (next > mem_heapsize() / MM_GROW_RATIO)
+        next = mem_heapsize() / MM_GROW_RATIO;
+    grow_chunk = MAX(next & ~(size_t)(CHUNKSIZE - 1), CHUNKSIZE);
+    grow_last = size;
+    grow_mallocs = 0;
+}
+
 /*
  * coalesce - 인접 빈 블록 병합 (병합 시 리스트에서 제거)
  */
 static void *coalesce(void *bp)
 {
+    SIM_FUNC(CS_COALESCE);
     /* 이전 블록의 할당 상태 (푸터에서 확인) */
     size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
     /* 다음 블록의 할당 상태 (헤더에서 확인) */
@@ -343,11 +1018,14 @@ static void *coalesce(void *bp)
     /* Case 1: 이전, 다음 블록 모두 할당됨 */
     if (prev_alloc && next_alloc)
     {
+        STAT_INC(coalesce_cases[0]);
+        PROBE2(coalesce, 1, size);
         return bp; /* 아무것도 안 하고 bp 반환 */
     }
     /* Case 2: 이전(할당됨), 다음(비어있음) -> 현재(bp)와 다음 병합 */
     else if (prev_alloc && !next_alloc)
     {
+        STAT_INC(coalesce_cases[1]);
         remove_from_list(NEXT_BLKP(bp));       /* 다음 블록을 리스트에서 제거 */
         size += GET_SIZE(HDRP(NEXT_BLKP(bp))); /* 현재 크기에 다음 블록 크기 더함 */
         PUT(HDRP(bp), PACK(size, 0));          /* 현재 블록(bp)의 헤더 업데이트 */
@@ -357,6 +1035,7 @@ static void *coalesce(void *bp)
     /* Case 3: 이전(비어있음), 다음(할당됨) -> 이전과 현재(bp) 병합 */
     else if (!prev_alloc && next_alloc)
     {
+        STAT_INC(coalesce_cases[2]);
         remove_from_list(PREV_BLKP(bp));         /* 이전 블록을 리스트에서 제거 */
         size += GET_SIZE(HDRP(PREV_BLKP(bp)));   /* 현재 크기에 이전 블록 크기 더함 */
         PUT(FTRP(bp), PACK(size, 0));            /* 현재 블록(bp)의 푸터 업데이트 (새 끝) */
@@ -366,6 +1045,7 @@ static void *coalesce(void *bp)
     /* Case 4: 이전(비어있음), 다음(비어있음) -> 이전, 현재(bp), 다음 모두 병합 */
     else
     {
+        STAT_INC(coalesce_cases[3]);
         remove_from_list(PREV_BLKP(bp)); /* 이전 블록 제거 */
         remove_from_list(NEXT_BLKP(bp)); /* 다음 블록 제거 */
         size += GET_SIZE(HDRP(PREV_BLKP(bp))) +
@@ -374,23 +1054,30 @@ static void *coalesce(void *bp)
         PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0)); /* 다음 블록 푸터 업데이트 (새 끝) */
         bp = PREV_BLKP(bp);                      /* bp를 이전 블록(병합된 블록의 시작)으로 이동 */
     }
+    PROBE2(coalesce, prev_alloc ? 2 : (next_alloc ? 3 : 4), size);
     /* 병합된 블록의 시작 포인터(bp) 반환 */
     return bp;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*
- * mm_malloc - (Segregated Best-Fit)
+ * seg_malloc - (Segregated Best-Fit)
  */
-void *mm_malloc(size_t size)
+static void *seg_malloc(size_t size)
 {
+    SIM_FUNC(CS_MM_MALLOC);
     size_t asize;      /* 실제 할당할 조정된 블록 크기 */
     size_t extendsize; /* 힙 확장 크기 */
     char *bp;          /* 블록 포인터 */
 
+    PROBE1(malloc_entry, size);
+
     /* 1. 요청 크기가 0이면 무시 (NULL 반환) */
     if (size == 0)
+    {
+        PROBE2(malloc_exit, NULL, size);
         return NULL;
+    }
 
     /* 2. 실제 할당 크기(asize) 계산 (최소 24바이트 보장) */
     if (size <= (2 * DSIZE)) /* 요청이 16B(prev+next 포인터 공간)보다 작거나 같으면 */
@@ -403,25 +1090,39 @@ void *mm_malloc(size_t size)
         asize = ALIGN(size + DSIZE);
         /* (주석: (size + (DSIZE) + (DSIZE - 1)) / DSIZE) * DSIZE 와 동일) */
     }
+    STAT_INC(mallocs[get_class_index(asize)]);
+    grow_mallocs++;
 
     /* 3. Best-fit으로 빈 블록 리스트에서 적절한 블록(bp) 찾기 */
     if ((bp = find_fit(asize)) != NULL)
     {
-        place(bp, asize); /* 찾은 블록에 배치(및 분할) */
-        return bp;        /* 새 블록의 페이로드 포인터 반환 */
+        bp = place(bp, asize); /* 찾은 블록에 배치(및 분할) */
+        PROF_MALLOC(bp, size);
+        PROBE2(malloc_exit, bp, size);
+        return bp; /* 새 블록의 페이로드 포인터 반환 */
     }
 
-    /* 4. (find_fit 실패) 맞는 블록이 없으면 힙 확장 */
-    /* 확장 크기는 (요청한 asize)와 (기본 CHUNKSIZE) 중 더 큰 값 */
-    extendsize = MAX(asize, CHUNKSIZE);
-    /* extend_heap 호출 (내부적으로 coalesce + insert_into_list 수행) */
-    if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+    /* 4. (find_fit 실패) 맞는 블록이 없으면 wilderness에서 자름. 모자라면 힙 확장 */
+    PROBE1(find_fit_miss, asize);
+    bp = wild_bp;
+    if (bp == NULL || GET_SIZE(HDRP(bp)) < asize)
     {
-        return NULL; /* 힙 확장에 실패하면 NULL (메모리 고갈) */
+        /* 확장 크기는 (모자란 만큼)과 (현재 확장 단위) 중 큰 값. 새 공간은 wilderness와 병합됨 */
+        extendsize = MAX(asize - (bp != NULL ? GET_SIZE(HDRP(bp)) : 0), grow_chunk);
+        /* extend_heap 호출 (내부적으로 coalesce + insert_into_list 수행) */
+        if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+        {
+            PROBE2(malloc_exit, NULL, size);
+            return NULL; /* 힙 확장에 실패하면 NULL (메모리 고갈) */
+        }
+        grow_policy(extendsize);
     }
-    /* 5. 새로 확장된 빈 블록(bp)에 배치 */
-    place(bp, asize); /* (place는 이 블록을 리스트에서 제거하고 할당함) */
-    return bp;        /* 새 블록의 페이로드 포인터 반환 */
+    STAT_INC(wild_allocs);
+    /* 5. wilderness(bp)에 배치. 남는 뒷부분이 새 wilderness가 됨 */
+    bp = place(bp, asize); /* (place는 이 블록을 리스트에서 제거하고 할당함) */
+    PROF_MALLOC(bp, size);
+    PROBE2(malloc_exit, bp, size);
+    return bp; /* 새 블록의 페이로드 포인터 반환 */
 }
 
 /*
@@ -429,6 +1130,7 @@ void *mm_malloc(size_t size)
  */
 static void *find_fit(size_t asize)
 {
+    SIM_FUNC(CS_FIND_FIT);
     void *bp;             /* 리스트 순회용 포인터 */
     void *best_bp = NULL; /* 현재까지 찾은 최적의 블록 포인터 */
     /* 현재까지 찾은 최적의 (csize - asize) 차이. (최대값으로 초기화) */
@@ -436,15 +1138,35 @@ static void *find_fit(size_t asize)
 
     /* 1. 요청한 크기(asize)가 속하는 크기 클래스 인덱스 찾기 */
     int list_index = get_class_index(asize);
+    STAT_INC(find_fit_calls);
+
+    /* 1a. 작은 요청은 자기 클래스에 크기가 딱 맞는 블록이 없으면 dv의 앞부분을 씀
+     *     (dv는 wilderness일 수도 있고 wilderness에는 크기 사본이 없으므로 헤더를 읽음) */
+    if (asize <= DV_MAX && dv_bp != NULL && GET_SIZE(HDRP(dv_bp)) >= asize)
+    {
+        for (bp = SEG_ROOT(list_index); bp != NULL; bp = GET_NEXT_FREE(bp))
+        {
+            STAT_INC(find_fit_visits);
+            if (NODE_SIZE(bp) == asize)
+                return bp;
+        }
+        STAT_INC(dv_hits);
+        return dv_bp;
+    }
 
     /* 2. 해당 인덱스부터 마지막 클래스까지 순서대로 리스트 탐색 */
     for (int i = list_index; i < NUM_CLASSES; i++)
     {
-        bp = seg_list_roots[i]; /* 현재 클래스 리스트의 head */
+        bp = SEG_ROOT(i); /* 현재 클래스 리스트의 head */
         /* 3. 현재 리스트의 끝(NULL)까지 모든 빈 블록 순회 */
         while (bp != NULL)
         {
-            size_t current_size = GET_SIZE(HDRP(bp));
+            STAT_INC(find_fit_visits);
+            /* 다음 링크를 먼저 읽어 다음 노드를 미리 가져오고, 그동안 현재 노드를 비교 */
+            void *next = GET_NEXT_FREE(bp);
+            if (next != NULL)
+                PREFETCH_NODE(next);
+            size_t current_size = NODE_SIZE(bp);
             /* 4. 현재 블록이 요청 크기(asize)보다 크거나 같으면 (후보) */
             if (current_size >= asize)
             {
@@ -460,29 +1182,73 @@ static void *find_fit(size_t asize)
                         return best_bp; /* 즉시 반환 (처리율 향상) */
                 }
             }
-            bp = GET_NEXT_FREE(bp); /* 리스트의 다음 빈 블록으로 이동 */
+            bp = next; /* 리스트의 다음 빈 블록으로 이동 */
         }
     }
 
     /* 7. 모든 리스트 탐색 후 찾은 best_bp 반환 (못 찾았으면 NULL) */
+    if (best_bp == NULL)
+        STAT_INC(find_fit_misses);
     return best_bp;
 }
 
+#ifdef MM_BOUNDARY
+/*
+ * boundary_lead - 크기 csize인 빈 블록 bp에 asize를 놓을 때, payload가 경계를 걸치지 않게 하려면
+ * 앞에서 떼어낼 바이트 수 (0이면 제자리). payload가 캐시 라인 이하면 라인 경계, 페이지 이하면 페이지 경계.
+ * 떼어낸 앞 조각도 블록이 되어야 하므로 0이 아니면 MIN_BLOCK_SIZE 이상. 블록 안에 자리가 없으면 0.
+ */
+static size_t boundary_lead(char *bp, size_t csize, size_t asize)
+{
+    size_t psize = asize - DSIZE;
+    size_t b = psize <= BOUNDARY_LINE ? BOUNDARY_LINE : (psize <= BOUNDARY_PAGE ? BOUNDARY_PAGE : 0);
+    uintptr_t p = (uintptr_t)bp;
+
+    if (b == 0 || (p & ~(b - 1)) == ((p + psize - 1) & ~(b - 1)))
+        return 0;
+    /* 경계를 걸치는 자리에서 오른쪽으로 옮기면 다음 경계에서 시작할 때까지 계속 걸침 */
+    uintptr_t q = (p + b - 1) & ~(uintptr_t)(b - 1);
+    if (q - p < MIN_BLOCK_SIZE)
+        q = (p + MIN_BLOCK_SIZE + psize <= q + b) ? p + MIN_BLOCK_SIZE : q + b;
+    return (q - p) + asize <= csize ? q - p : 0;
+}
+#endif
+
 /*
- * place - 찾은 빈 블록(bp)에 요청한 크기(asize)를 배치 (및 분할)
+ * place - 찾은 빈 블록(bp)에 요청한 크기(asize)를 배치 (및 분할). 배치한 블록의 bp 반환
+ * (MM_BOUNDARY 빌드에서는 경계를 피해 블록 안쪽으로 옮겨질 수 있음)
  */
-static void place(void *bp, size_t asize)
+static void *place(void *bp, size_t asize)
 {
+    SIM_FUNC(CS_PLACE);
     /* 1. 배치할 빈 블록의 전체 크기(csize) 가져오기 */
     size_t csize = GET_SIZE(HDRP(bp));
 
     /* 2. 이 블록은 이제 할당될 것이므로, 빈 리스트에서 *제거* */
     remove_from_list(bp);
+#ifdef MM_BOUNDARY
+    /* 2a. 경계를 걸치면 앞 조각을 빈 블록으로 떼어내고 그 뒤에 배치 */
+    size_t lead = boundary_lead(bp, csize, asize);
+    if (lead > 0)
+    {
+        char *fp = bp;
+        bp = fp + lead;
+        csize -= lead;
+        PUT(HDRP(bp), PACK(csize, 0));
+        PUT(FTRP(bp), PACK(csize, 0));
+        PUT(HDRP(fp), PACK(lead, 0));
+        PUT(FTRP(fp), PACK(lead, 0));
+        insert_into_list(fp); /* fp 앞은 원래 빈 블록의 이웃이라 할당된 블록이므로 병합할 것 없음 */
+        STAT_INC(boundary_shifts);
+        STAT_ADD(boundary_lead_bytes, lead);
+    }
+#endif
 
     /* 3. (csize - asize) (남는 공간)가 최소 블록 크기(24B)보다 크거나 같은가? */
     if ((csize - asize) >= MIN_BLOCK_SIZE)
     {
         /* 4. (Yes) 블록 분할(Split) 수행 */
+        STAT_INC(place_splits);
         /* 4a. 앞부분(asize)은 '할당됨(1)'으로 헤더/푸터 설정 */
         PUT(HDRP(bp), PACK(asize, 1));
         PUT(FTRP(bp), PACK(asize, 1));
@@ -495,6 +1261,9 @@ static void place(void *bp, size_t asize)
 
         /* 4d. 새로 생성된 이 '남은 빈 블록'을 빈 리스트에 *삽입* */
         insert_into_list(remainder_bp);
+        /* 4e. 작은 요청이 자른 나머지는 dv가 되어 다음 작은 요청이 바로 이어서 씀 */
+        if (asize <= DV_MAX)
+            dv_bp = remainder_bp;
     }
     else
     {
@@ -503,20 +1272,25 @@ static void place(void *bp, size_t asize)
         PUT(HDRP(bp), PACK(csize, 1));
         PUT(FTRP(bp), PACK(csize, 1));
     }
+    return bp;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*
- * mm_free - 메모리 반환 및 리스트 삽입
+ * seg_free - 메모리 반환 및 리스트 삽입
  */
-void mm_free(void *bp)
+static void seg_free(void *bp)
 {
+    SIM_FUNC(CS_MM_FREE);
     /* 1. bp가 NULL이거나, 이미 free된 블록(할당 비트 0)이면 오류이므로 즉시 반환 */
     if (bp == NULL || GET_ALLOC(HDRP(bp)) == 0)
         return;
+    PROF_FREE(bp);
+    heap_gen++;
 
     /* 2. 현재 블록 크기 가져오기 */
     size_t size = GET_SIZE(HDRP(bp));
+    STAT_INC(frees[get_class_index(size)]);
 
     /* 3. 헤더와 푸터의 할당 비트를 0('비어있음')으로 설정 */
     PUT(HDRP(bp), PACK(size, 0));
@@ -536,10 +1310,108 @@ void mm_free(void *bp)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 /*
- * mm_realloc - realloc 구현 (병합 최적화 포함)
+ * 큰 블록 복사 (realloc, 압축).
+ * NT_COPY_THRESHOLD 이상이면 캐시를 거치지 않는 스트리밍 저장으로 복사해서, 곧 다시 쓰지 않을
+ * 옛 payload와 새 payload가 캐시의 다른 데이터를 밀어내지 않게 함. 그보다 작으면 libc가 더 빠름.
+ * 커널은 mm_init에서 CPU를 보고 고름 (AVX2가 있으면 32B, 없으면 SSE2 16B 단위).
+ * realloc/압축의 이동은 항상 낮은 주소 쪽(dst < src)이라 앞에서부터 복사하면 겹쳐도 안전함:
+ * 각 반복은 읽기를 모두 마친 뒤 쓰고, 쓰는 위치는 항상 다음에 읽을 위치보다 앞이기 때문.
+ * dst가 src 뒤에서 겹치는 경우는 memmove로 넘김.
+ * LARGE_MIN 이상의 블록은 mremap으로 옮겨져 여기를 지나지 않으므로, 임계값은 LARGE_MIN보다 작아야 함.
  */
-void *mm_realloc(void *ptr, size_t size)
+#ifndef NT_COPY_THRESHOLD
+#define NT_COPY_THRESHOLD (64 * 1024)
+#endif
+#if defined(MM_NT_COPY) && NT_COPY_THRESHOLD >= LARGE_MIN
+#error "NT_COPY_THRESHOLD must be below LARGE_MIN (larger blocks are moved with mremap)"
+#endif
+
+#ifdef MM_NT_COPY
+/* copy_nt_sse2 - 16B 정렬된 dst에 64B씩 스트리밍 저장 */
+__attribute__((target("sse2"))) static void copy_nt_sse2(char *dst, const char *src, size_t n)
+{
+    size_t head = (-(uintptr_t)dst) & 15;
+
+    memmove(dst, src, head);
+    dst += head, src += head, n -= head;
+    for (; n >= 64; dst += 64, src += 64, n -= 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)src);
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+        _mm_stream_si128((__m128i *)dst, a);
+        _mm_stream_si128((__m128i *)(dst + 16), b);
+        _mm_stream_si128((__m128i *)(dst + 32), c);
+        _mm_stream_si128((__m128i *)(dst + 48), d);
+    }
+    _mm_sfence(); /* 스트리밍 저장은 순서가 약하므로 이후의 일반 저장보다 먼저 보이게 함 */
+    memmove(dst, src, n);
+}
+
+/* copy_nt_avx2 - 32B 정렬된 dst에 128B씩 스트리밍 저장 */
+__attribute__((target("avx2"))) static void copy_nt_avx2(char *dst, const char *src, size_t n)
+{
+    size_t head = (-(uintptr_t)dst) & 31;
+
+    memmove(dst, src, head);
+    dst += head, src += head, n -= head;
+    for (; n >= 128; dst += 128, src += 128, n -= 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)src);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(src + 96));
+        _mm256_stream_si256((__m256i *)dst, a);
+        _mm256_stream_si256((__m256i *)(dst + 32), b);
+        _mm256_stream_si256((__m256i *)(dst + 64), c);
+        _mm256_stream_si256((__m256i *)(dst + 96), d);
+    }
+    _mm_sfence();
+    memmove(dst, src, n);
+}
+
+/* mm_init에서 고른 커널 */
+static void (*copy_nt)(char *dst, const char *src, size_t n);
+
+static void select_copy_kernel(void)
+{
+    __builtin_cpu_init();
+    copy_nt = __builtin_cpu_supports("avx2") ? copy_nt_avx2 : copy_nt_sse2;
+}
+#endif
+
+/*
+ * copy_block - n바이트를 src에서 dst로 복사 (memmove처럼 겹쳐도 됨)
+ */
+static void copy_block(void *dst, const void *src, size_t n)
+{
+#ifdef MM_STATS
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+#endif
+#ifdef MM_NT_COPY
+    if (n >= NT_COPY_THRESHOLD && !((char *)dst > (char *)src && (char *)dst < (char *)src + n))
+    {
+        copy_nt(dst, src, n);
+        STAT_ADD(copy_nt_bytes, n);
+    }
+    else
+#endif
+        memmove(dst, src, n);
+#ifdef MM_STATS
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    mm_stats.copy_ns += (t1.tv_sec - t0.tv_sec) * 1000000000UL + (t1.tv_nsec - t0.tv_nsec);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ * seg_realloc - realloc 구현 (병합 최적화 포함)
+ */
+static void *seg_realloc(void *ptr, size_t size)
 {
+    SIM_FUNC(CS_MM_REALLOC);
     void *oldptr = ptr;    /* 이전 블록 포인터 */
     void *newptr;          /* 새 블록 포인터 */
     size_t old_size;       /* 이전 블록의 *전체* 크기 */
@@ -551,14 +1423,20 @@ void *mm_realloc(void *ptr, size_t size)
     /* 1. size == 0 -> free(ptr)와 동일 */
     if (size == 0)
     {
-        mm_free(oldptr);
+        seg_free(oldptr);
         return NULL;
     }
     /* 2. ptr == NULL -> malloc(size)와 동일 */
     if (oldptr == NULL)
     {
-        return mm_malloc(size);
+        return seg_malloc(size);
     }
+    heap_gen++;
+#ifdef MM_PROFILE
+    /* 샘플링된 블록은 프로파일러가 기록을 새 포인터로 옮겨야 하므로 따로 처리 */
+    if (GET(HDRP(oldptr)) & PROF_BIT)
+        return prof_realloc(oldptr, size);
+#endif
 
     /* --- 새 블록 크기 계산 --- */
     if (size <= (2 * DSIZE)) /* 16B 이하 요청 */
@@ -569,6 +1447,7 @@ void *mm_realloc(void *ptr, size_t size)
     {
         new_asize = ALIGN(size + DSIZE); /* size + 헤더/푸터(8B) + 정렬 */
     }
+    STAT_INC(reallocs[get_class_index(new_asize)]);
 
     /* 이전 블록의 전체 크기 가져오기 */
     old_size = GET_SIZE(HDRP(oldptr));
@@ -592,6 +1471,8 @@ void *mm_realloc(void *ptr, size_t size)
             insert_into_list(coalesce(remainder_bp));
         }
         /* 분할 못하면(남는 공간 < 24B) 그냥 oldptr 반환 (내부 단편화) */
+        STAT_INC(realloc_inplace);
+        PROBE2(realloc_inplace, oldptr, size);
         return oldptr;
     }
 
@@ -619,11 +1500,23 @@ void *mm_realloc(void *ptr, size_t size)
                 PUT(HDRP(oldptr), PACK(new_asize, 1));    /* 헤더 크기 업데이트 */
                 PUT(FTRP(oldptr), PACK(new_asize, 1));    /* 새 푸터 위치에 값 쓰기 */
                 PUT(HDRP(NEXT_BLKP(oldptr)), PACK(0, 1)); /* 새 에필로그 설치 */
-                return oldptr;                            /* 데이터 복사 필요 없음! */
+                STAT_INC(realloc_inplace);
+                PROBE2(realloc_inplace, oldptr, size);
+                return oldptr; /* 데이터 복사 필요 없음! */
             }
             /* 힙 확장 실패 시, 아래의 일반 로직(Subcase 2d)으로 넘어감 */
         }
 
+        /* (Subcase 2_wilderness)
+         * 다음 블록이 힙 끝의 빈 블록인데 모자라면, 모자란 만큼 힙을 늘려 아래 Subcase 2a로 제자리 확장.
+         * extend_heap이 새 공간을 next_bp와 병합하므로 next_bp의 시작은 그대로임.
+         */
+        if (!next_alloc && GET_SIZE(HDRP(NEXT_BLKP(next_bp))) == 0 && old_size + next_size < new_asize &&
+            extend_heap((new_asize - old_size - next_size) / WSIZE) != NULL)
+        {
+            next_size = GET_SIZE(HDRP(next_bp));
+        }
+
         /* [!!! REALLOC 최적화 2 !!!] (Subcase 2a)
          * 다음 블록만 '비어있고', 합친 크기가 충분한가?
          */
@@ -644,6 +1537,8 @@ void *mm_realloc(void *ptr, size_t size)
                 PUT(FTRP(remainder_bp), PACK(remainder_size, 0));
                 insert_into_list(coalesce(remainder_bp)); /* 리스트 삽입 */
             }
+            STAT_INC(realloc_inplace);
+            PROBE2(realloc_inplace, oldptr, size);
             return oldptr; /* 데이터 복사 필요 없음! */
         }
 
@@ -655,7 +1550,7 @@ void *mm_realloc(void *ptr, size_t size)
             remove_from_list(prev_bp); /* 이전 빈 블록 리스트에서 제거 */
             /* (데이터 복사 먼저!) 겹칠 수 있으므로 memmove 사용 */
             copySize = old_size - DSIZE;        /* 실제 페이로드 크기 */
-            memmove(prev_bp, oldptr, copySize); /* 데이터를 이전 블록 위치로 이동 */
+            copy_block(prev_bp, oldptr, copySize); /* 데이터를 이전 블록 위치로 이동 */
 
             /* 헤더/푸터 업데이트 */
             PUT(HDRP(prev_bp), PACK(combined_size, 1));
@@ -672,6 +1567,9 @@ void *mm_realloc(void *ptr, size_t size)
                 PUT(FTRP(remainder_bp), PACK(remainder_size, 0));
                 insert_into_list(coalesce(remainder_bp)); /* 리스트 삽입 */
             }
+            STAT_INC(realloc_move);
+            STAT_ADD(realloc_copied_bytes, copySize);
+            PROBE3(realloc_move, oldptr, prev_bp, copySize);
             return prev_bp; /* (중요) 포인터가 변경되었으므로 prev_bp 반환 */
         }
 
@@ -685,7 +1583,7 @@ void *mm_realloc(void *ptr, size_t size)
 
             /* (데이터 복사 먼저!) */
             copySize = old_size - DSIZE;
-            memmove(prev_bp, oldptr, copySize);
+            copy_block(prev_bp, oldptr, copySize);
 
             /* 헤더/푸터 업데이트 */
             PUT(HDRP(prev_bp), PACK(combined_size, 1));
@@ -702,6 +1600,9 @@ void *mm_realloc(void *ptr, size_t size)
                 PUT(FTRP(remainder_bp), PACK(remainder_size, 0));
                 insert_into_list(coalesce(remainder_bp));
             }
+            STAT_INC(realloc_move);
+            STAT_ADD(realloc_copied_bytes, copySize);
+            PROBE3(realloc_move, oldptr, prev_bp, copySize);
             return prev_bp; /* (중요) 포인터가 변경되었으므로 prev_bp 반환 */
         }
 
@@ -710,7 +1611,7 @@ void *mm_realloc(void *ptr, size_t size)
          */
         else
         {
-            newptr = mm_malloc(size); /* (주의: asize가 아닌 원본 size로 요청) */
+            newptr = seg_malloc(size); /* (주의: asize가 아닌 원본 size로 요청) */
             if (newptr == NULL)
                 return NULL;
 
@@ -719,9 +1620,1747 @@ void *mm_realloc(void *ptr, size_t size)
             if (size < copySize)
                 copySize = size;
 
-            memcpy(newptr, oldptr, copySize); /* 데이터 복사 */
-            mm_free(oldptr);                  /* 이전 블록 해제 */
-            return newptr;                    /* 새 포인터 반환 */
+            copy_block(newptr, oldptr, copySize); /* 데이터 복사 */
+            seg_free(oldptr);                 /* 이전 블록 해제 */
+            STAT_INC(realloc_copy);
+            STAT_ADD(realloc_copied_bytes, copySize);
+            PROBE3(realloc_move, oldptr, newptr, copySize);
+            return newptr; /* 새 포인터 반환 */
+        }
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef MM_LOCKPROF
+/* lock_holder - lp에서 func의 기록을 찾거나 새로 만듦 (칸이 모자라면 NULL) */
+static lock_holder_t *lock_holder(lock_prof_t *lp, const char *func)
+{
+    for (int i = 0; i < LOCK_MAX_HOLDERS; i++)
+    {
+        if (lp->holders[i].func == func)
+            return &lp->holders[i];
+        if (lp->holders[i].func == NULL)
+        {
+            lp->holders[i].func = func;
+            return &lp->holders[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * lock_acquire - m을 잡고 lp에 기록. trylock이 실패하면 그때 잡고 있던 함수를 기억해 두고
+ * 기다린 시간을 잰 뒤, 잠금을 얻은 다음 히스토그램과 그 함수의 blocked에 더함.
+ */
+static void lock_acquire(pthread_mutex_t *m, lock_prof_t *lp, const char *func)
+{
+    lock_holder_t *h;
+
+    if (pthread_mutex_trylock(m) != 0)
+    {
+        const char *blocker = __atomic_load_n(&lp->holder, __ATOMIC_RELAXED);
+        struct timespec t0, t1;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        pthread_mutex_lock(m);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        unsigned long ns = (t1.tv_sec - t0.tv_sec) * 1000000000UL + t1.tv_nsec - t0.tv_nsec;
+        int bucket = ns ? 63 - __builtin_clzl(ns) : 0;
+        lp->contended++;
+        lp->wait_ns += ns;
+        if (ns > lp->max_wait_ns)
+            lp->max_wait_ns = ns;
+        lp->wait_hist[bucket < LOCK_HIST_BUCKETS ? bucket : LOCK_HIST_BUCKETS - 1]++;
+        if (blocker != NULL && (h = lock_holder(lp, blocker)) != NULL)
+        {
+            h->blocked++;
+            h->blocked_ns += ns;
         }
     }
-}
\ No newline at end of file
+    lp->acquisitions++;
+    if ((h = lock_holder(lp, func)) != NULL)
+        h->acquisitions++;
+    __atomic_store_n(&lp->holder, func, __ATOMIC_RELAXED);
+}
+
+static void lock_release(pthread_mutex_t *m, lock_prof_t *lp)
+{
+    __atomic_store_n(&lp->holder, NULL, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(m);
+}
+#endif
+
+#ifdef MM_LOCKFREE
+/*
+ * lf_pop - 크기 클래스 cls의 스택에서 블록 하나를 꺼냄 (비어 있으면 NULL)
+ * top의 next를 읽은 뒤 다른 스레드가 그 블록을 꺼내 썼더라도, 그 사이 세대 번호가 바뀌므로 CAS가 실패함.
+ * 블록은 힙 안에 그대로 있으므로(힙은 줄어들지 않음) 낡은 next를 읽는 것 자체는 안전.
+ */
+static void *lf_pop(size_t cls)
+{
+    uint64_t old = __atomic_load_n(&lf_heads[cls], __ATOMIC_ACQUIRE);
+    for (;;)
+    {
+        uint32_t off = (uint32_t)old;
+        if (off == 0)
+            return NULL;
+        char *bp = lf_base + off;
+        uint32_t next = __atomic_load_n((uint32_t *)bp, __ATOMIC_RELAXED);
+        uint64_t new = (((old >> 32) + 1) << 32) | next;
+        if (__atomic_compare_exchange_n(&lf_heads[cls], &old, new, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            return bp;
+    }
+}
+
+/*
+ * lf_push - 블록 bp를 크기 클래스 cls의 스택에 넣음
+ */
+static void lf_push(size_t cls, void *bp)
+{
+    uint32_t off = (uint32_t)((char *)bp - lf_base);
+    uint64_t old = __atomic_load_n(&lf_heads[cls], __ATOMIC_RELAXED);
+    uint64_t new;
+    do
+    {
+        __atomic_store_n((uint32_t *)bp, (uint32_t)old, __ATOMIC_RELAXED);
+        new = (((old >> 32) + 1) << 32) | off;
+    } while (!__atomic_compare_exchange_n(&lf_heads[cls], &old, new, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+#endif
+
+#ifdef MM_TCACHE
+/*
+ * tc_put_batch - 블록 n개가 TC_NEXT로 이어진 배치(head)를 전달 캐시에 넣음.
+ * 전달 캐시가 가득 찼으면 잠금을 잡고 seg 힙에 돌려주고, 이 클래스의 배치 크기를 줄임.
+ */
+static void tc_put_batch(size_t cls, void *head, unsigned int n)
+{
+    if (__atomic_add_fetch(&tc_batches[cls], 1, __ATOMIC_RELAXED) <= TC_MAX_BATCHES)
+    {
+        TC_COUNT(head) = n;
+        lf_push(cls, head);
+        return;
+    }
+    __atomic_sub_fetch(&tc_batches[cls], 1, __ATOMIC_RELAXED);
+
+    unsigned int batch = __atomic_load_n(&tc_batch[cls], __ATOMIC_RELAXED);
+    if (batch > TC_MIN_BATCH)
+        __atomic_store_n(&tc_batch[cls], batch / 2, __ATOMIC_RELAXED);
+    MM_LOCK();
+    while (head != NULL)
+    {
+        void *next = TC_NEXT(head);
+        seg_free(head);
+        head = next;
+    }
+    MM_UNLOCK();
+}
+
+/*
+ * tc_flush - 스레드 캐시 리스트의 앞쪽 n개를 배치로 떼어 전달 캐시로 보냄
+ */
+static void tc_flush(size_t cls, unsigned int n)
+{
+    tc_list_t *list = &tcache.lists[cls];
+    void *head = list->head, *tail = head;
+
+    if (n > list->count)
+        n = list->count;
+    if (n == 0)
+        return;
+    for (unsigned int i = 1; i < n; i++)
+        tail = TC_NEXT(tail);
+    list->head = TC_NEXT(tail);
+    list->count -= n;
+    TC_NEXT(tail) = NULL;
+    tc_put_batch(cls, head, n);
+}
+
+/*
+ * tc_thread_exit - 스레드가 끝날 때 그 스레드 캐시의 블록을 모두 전달 캐시로 돌려줌
+ */
+static void tc_thread_exit(void *arg)
+{
+    (void)arg;
+    if (tcache.epoch != __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE))
+        return;
+    for (size_t cls = 0; cls < LF_CLASSES; cls++)
+    {
+        while (tcache.lists[cls].count > 0)
+            tc_flush(cls, __atomic_load_n(&tc_batch[cls], __ATOMIC_RELAXED));
+    }
+}
+
+static void tc_key_create(void)
+{
+    pthread_key_create(&tc_key, tc_thread_exit);
+}
+
+/*
+ * tc_get_batch - 클래스 cls의 블록 배치 하나를 가져옴 (TC_NEXT로 이어진 체인의 head, *n = 블록 수).
+ * 전달 캐시의 배치를 받고, 전달 캐시도 비었으면 잠금을 잡고 seg 힙에서 배치 크기만큼 할당
+ * (그리고 배치 크기를 키움). 힙이 모자라면 NULL.
+ */
+static void *tc_get_batch(size_t cls, unsigned int *n)
+{
+    void *head;
+
+    if ((head = lf_pop(cls)) != NULL)
+    {
+        __atomic_sub_fetch(&tc_batches[cls], 1, __ATOMIC_RELAXED);
+        *n = TC_COUNT(head);
+        return head;
+    }
+
+    unsigned int batch = __atomic_load_n(&tc_batch[cls], __ATOMIC_RELAXED);
+    if (batch < TC_MAX_BATCH)
+        __atomic_store_n(&tc_batch[cls], batch * 2, __ATOMIC_RELAXED);
+
+    *n = 0;
+    MM_LOCK();
+    for (unsigned int i = 0; i < batch; i++)
+    {
+        /* 크기 cls * 8의 블록을 주는 요청 크기는 cls * 8 - DSIZE (seg_malloc의 asize 계산 참조) */
+        void *bp = seg_malloc(cls * DSIZE - DSIZE);
+        if (bp == NULL)
+            break;
+        TC_NEXT(bp) = head;
+        head = bp;
+        (*n)++;
+    }
+    MM_UNLOCK();
+    return head;
+}
+
+/*
+ * tc_fill - 비어 있는 스레드 캐시 리스트를 배치 하나로 채우고 그중 블록 하나를 반환
+ */
+static void *tc_fill(size_t cls)
+{
+    tc_list_t *list = &tcache.lists[cls];
+    unsigned int n;
+    void *bp;
+
+    if (!tcache.registered)
+    {
+        pthread_once(&tc_key_once, tc_key_create);
+        pthread_setspecific(tc_key, &tcache);
+        tcache.registered = 1;
+    }
+    if ((bp = tc_get_batch(cls, &n)) == NULL)
+        return NULL;
+    list->head = TC_NEXT(bp);
+    list->count = n - 1;
+    return bp;
+}
+
+#ifdef MM_PERCPU
+/* 현재 스레드의 rseq 영역 (glibc가 등록) */
+static inline struct rseq *pc_rseq(void)
+{
+    return (struct rseq *)((char *)__builtin_thread_pointer() + __rseq_offset);
+}
+
+/*
+ * rseq 임계 구역 기술자(__rseq_cs 섹션)와 abort 핸들러(__rseq_failure 섹션).
+ * 구역 [1, 2) 안에서 선점/시그널/CPU 이동이 일어나면 커널이 4로 보내고, 4는 retry로 점프.
+ * abort 주소 바로 앞 4바이트는 glibc가 등록할 때 쓴 RSEQ_SIG여야 함.
+ */
+#define PC_ASM_BEGIN                                           \
+    ".pushsection __rseq_cs, \"aw\"\n\t"                      \
+    ".balign 32\n\t"                                           \
+    "3:\n\t"                                                   \
+    ".long 0x0, 0x0\n\t"                                       \
+    ".quad 1f, 2f - 1f, 4f\n\t"                                \
+    ".popsection\n\t"                                          \
+    "leaq 3b(%%rip), %%rax\n\t"                                \
+    "movq %%rax, %[rseq_cs]\n\t"                               \
+    "1:\n\t"                                                   \
+    "cmpl %[cpu], %[cpu_id]\n\t"                               \
+    "jnz %l[retry]\n\t"
+#define PC_ASM_END                                             \
+    "2:\n\t"                                                   \
+    ".pushsection __rseq_failure, \"ax\"\n\t"                 \
+    ".byte 0x0f, 0xb9, 0x3d\n\t"                               \
+    ".long " PC_STR(RSEQ_SIG) "\n\t"                           \
+    "4:\n\t"                                                   \
+    "jmp %l[retry]\n\t"                                        \
+    ".popsection\n\t"
+#define PC_STR_(x) #x
+#define PC_STR(x) PC_STR_(x)
+
+/*
+ * pc_push - 현재 CPU의 cls 슬랩에 bp를 넣음. 성공하면 1, 가득 찼거나 rseq를 못 쓰면 0.
+ * 마지막 명령(길이 저장)이 커밋. 그 전에 중단되면 처음부터 다시 (슬롯에 쓴 값은 길이 밖이라 무해).
+ */
+static int pc_push(size_t cls, void *bp)
+{
+    struct rseq *rs = pc_rseq();
+
+    for (;;)
+    {
+        uint32_t cpu = __atomic_load_n(&rs->cpu_id, __ATOMIC_RELAXED);
+        if (cpu >= PC_MAX_CPUS)
+            return 0;
+        uint32_t *lenp = &pc_len[cpu].len[cls];
+        void **slots = pc_slots[cpu][cls];
+        __asm__ goto(
+            PC_ASM_BEGIN
+            "movl (%[lenp]), %%ecx\n\t"
+            "cmpl $" PC_STR(PC_CAP) ", %%ecx\n\t"
+            "jae %l[full]\n\t"
+            "movq %[bp], (%[slots], %%rcx, 8)\n\t"
+            "incl %%ecx\n\t"
+            "movl %%ecx, (%[lenp])\n\t"
+            PC_ASM_END
+            :
+            : [rseq_cs] "m"(rs->rseq_cs), [cpu_id] "m"(rs->cpu_id), [cpu] "r"(cpu),
+              [lenp] "r"(lenp), [slots] "r"(slots), [bp] "r"(bp)
+            : "memory", "cc", "rax", "rcx"
+            : retry, full);
+        return 1;
+    retry:
+        continue;
+    full:
+        return 0;
+    }
+}
+
+/*
+ * pc_pop - 현재 CPU의 cls 슬랩에서 블록 하나를 꺼냄. 비었거나 rseq를 못 쓰면 NULL.
+ */
+static void *pc_pop(size_t cls)
+{
+    struct rseq *rs = pc_rseq();
+    void *bp;
+
+    for (;;)
+    {
+        uint32_t cpu = __atomic_load_n(&rs->cpu_id, __ATOMIC_RELAXED);
+        if (cpu >= PC_MAX_CPUS)
+            return NULL;
+        uint32_t *lenp = &pc_len[cpu].len[cls];
+        void **slots = pc_slots[cpu][cls];
+        __asm__ goto(
+            PC_ASM_BEGIN
+            "movl (%[lenp]), %%ecx\n\t"
+            "testl %%ecx, %%ecx\n\t"
+            "jz %l[empty]\n\t"
+            "movq -8(%[slots], %%rcx, 8), %%rax\n\t"
+            "movq %%rax, %[bp]\n\t"
+            "decl %%ecx\n\t"
+            "movl %%ecx, (%[lenp])\n\t"
+            PC_ASM_END
+            : [bp] "=m"(bp)
+            : [rseq_cs] "m"(rs->rseq_cs), [cpu_id] "m"(rs->cpu_id), [cpu] "r"(cpu),
+              [lenp] "r"(lenp), [slots] "r"(slots)
+            : "memory", "cc", "rax", "rcx"
+            : retry, empty);
+        return bp;
+    retry:
+        continue;
+    empty:
+        return NULL;
+    }
+}
+
+/*
+ * pc_malloc - 현재 CPU 슬랩에서 할당. 비었으면 배치 하나를 받아 하나는 반환하고 나머지는 슬랩에 채움
+ * (슬랩이 넘치면 남은 블록은 다시 전달 캐시로).
+ */
+static void *pc_malloc(size_t cls)
+{
+    void *bp, *rest;
+    unsigned int n;
+
+    if ((bp = pc_pop(cls)) != NULL)
+        return bp;
+    if ((bp = tc_get_batch(cls, &n)) == NULL)
+        return NULL;
+    for (rest = TC_NEXT(bp), n--; rest != NULL; n--)
+    {
+        void *next = TC_NEXT(rest);
+        if (!pc_push(cls, rest))
+        {
+            tc_put_batch(cls, rest, n);
+            break;
+        }
+        rest = next;
+    }
+    return bp;
+}
+
+/*
+ * pc_free - 현재 CPU 슬랩에 넣음. 가득 찼으면 슬랩에서 배치 크기만큼 꺼내 bp와 함께 전달 캐시로 보냄.
+ */
+static void pc_free(size_t cls, void *bp)
+{
+    if (pc_push(cls, bp))
+        return;
+
+    unsigned int batch = __atomic_load_n(&tc_batch[cls], __ATOMIC_RELAXED);
+    unsigned int n = 1;
+    void *next;
+    TC_NEXT(bp) = NULL;
+    while (n < batch && (next = pc_pop(cls)) != NULL)
+    {
+        TC_NEXT(next) = bp;
+        bp = next;
+        n++;
+    }
+    tc_put_batch(cls, bp, n);
+}
+
+/* rseq로 현재 CPU 번호를 읽을 수 있는지 (등록 실패/미등록이면 cpu_id가 (uint32_t)-1, -2) */
+static inline int pc_usable(void)
+{
+    return pc_enabled && __atomic_load_n(&pc_rseq()->cpu_id, __ATOMIC_RELAXED) < PC_MAX_CPUS;
+}
+#endif
+
+/*
+ * tc_malloc - asize(8의 배수, LF_MAX_SIZE 이하) 블록을 스레드 캐시에서 할당
+ */
+static void *tc_malloc(size_t asize)
+{
+    size_t cls = asize / DSIZE;
+    tc_list_t *list = &tcache.lists[cls];
+
+#ifdef MM_PERCPU
+    if (pc_usable())
+        return pc_malloc(cls);
+#endif
+    if (tcache.epoch != __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE))
+    {
+        memset(tcache.lists, 0, sizeof(tcache.lists));
+        tcache.epoch = heap_epoch;
+    }
+    if (list->head != NULL)
+    {
+        void *bp = list->head;
+        list->head = TC_NEXT(bp);
+        list->count--;
+        return bp;
+    }
+    return tc_fill(cls);
+}
+
+/*
+ * tc_free - 작은 블록을 스레드 캐시에 넣음. 리스트가 배치 크기의 두 배를 넘으면 배치 하나를 내보냄.
+ */
+static void tc_free(void *bp, size_t size)
+{
+    size_t cls = size / DSIZE;
+    tc_list_t *list = &tcache.lists[cls];
+
+#ifdef MM_PERCPU
+    if (pc_usable())
+    {
+        pc_free(cls, bp);
+        return;
+    }
+#endif
+    if (tcache.epoch != __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE))
+    {
+        memset(tcache.lists, 0, sizeof(tcache.lists));
+        tcache.epoch = heap_epoch;
+    }
+    TC_NEXT(bp) = list->head;
+    list->head = bp;
+    unsigned int batch = __atomic_load_n(&tc_batch[cls], __ATOMIC_RELAXED);
+    if (++list->count > 2 * batch)
+        tc_flush(cls, batch);
+}
+#endif
+
+#ifdef MM_SHARDED
+/* shard_push - 페이지 pg를 리스트 *list의 head에 넣음 */
+static void shard_push(shard_page_t **list, shard_page_t *pg)
+{
+    pg->prev = NULL;
+    pg->next = *list;
+    if (pg->next != NULL)
+        pg->next->prev = pg;
+    *list = pg;
+}
+
+/* shard_unlink - 페이지 pg를 리스트 *list에서 뺌 */
+static void shard_unlink(shard_page_t **list, shard_page_t *pg)
+{
+    if (pg->prev != NULL)
+        pg->prev->next = pg->next;
+    else
+        *list = pg->next;
+    if (pg->next != NULL)
+        pg->next->prev = pg->prev;
+}
+
+/*
+ * shard_page_new - 현재 스레드가 소유하는 block_size 슬롯 페이지를 새로 만들어 리스트 head에 넣음.
+ * 첫 페이지는 슬롯 SHARD_FIRST_SLOTS개가 들어가는 크기(최소 SHARD_PAGE_MIN)로 시작해서,
+ * 이 크기의 페이지가 더 필요할 때마다 두 배로 키움 (SHARD_PAGE_SIZE까지).
+ * 작은 객체를 몇 개만 쓰는 스레드가 4KB 페이지를 힙 중간에 박아 두면 옆의 블록이 제자리에서 자라지 못하고
+ * 옮겨 가며 구멍을 남기기 때문 (realloc2-bal).
+ */
+static shard_page_t *shard_page_new(unsigned int block_size)
+{
+    shard_page_t *pg, *head = shard_tls.pages[block_size / DSIZE];
+    size_t page_size;
+
+    if (head != NULL)
+        page_size = 2 * GET_SIZE(HDRP(head));
+    else
+        page_size = MAX(SHARD_PAGE_MIN, ALIGN(sizeof(shard_page_t) + WSIZE) + SHARD_FIRST_SLOTS * block_size + DSIZE);
+    if (page_size > SHARD_PAGE_SIZE)
+        page_size = SHARD_PAGE_SIZE;
+    MM_LOCK();
+    pg = seg_malloc(page_size - DSIZE);
+    MM_UNLOCK();
+    if (pg == NULL)
+        return NULL;
+
+    __atomic_store_n(&pg->owner, shard_tls.id, __ATOMIC_RELAXED);
+    pg->thread_free = NULL;
+    pg->block_size = block_size;
+    pg->used = 0;
+
+    /* 슬롯을 뒤에서부터 free list에 넣어 앞쪽 슬롯부터 나가게 함 */
+    char *first = (char *)pg + ALIGN(sizeof(shard_page_t) + WSIZE);
+    char *end = (char *)pg + page_size - DSIZE;
+    size_t n = (end - first + WSIZE) / block_size;
+    pg->free = NULL;
+    for (size_t i = n; i-- > 0;)
+    {
+        char *bp = first + i * block_size;
+        PUT(HDRP(bp), (unsigned int)(bp - (char *)pg) | SHARD_BIT | 0x1);
+        *(void **)bp = pg->free;
+        pg->free = bp;
+    }
+
+    shard_push(&shard_tls.pages[block_size / DSIZE], pg);
+    return pg;
+}
+
+/*
+ * shard_collect - 다른 스레드가 해제한 객체(thread_free)를 통째로 가져와 로컬 free list에 붙임
+ */
+static void shard_collect(shard_page_t *pg)
+{
+    void *bp = __atomic_exchange_n(&pg->thread_free, NULL, __ATOMIC_ACQUIRE);
+    while (bp != NULL)
+    {
+        void *next = *(void **)bp;
+        *(void **)bp = pg->free;
+        pg->free = bp;
+        pg->used--;
+        bp = next;
+    }
+}
+
+/*
+ * shard_adopt - cls 크기의 버려진 페이지 하나를 현재 스레드가 넘겨받아 리스트 head에 넣음 (없으면 NULL)
+ */
+static shard_page_t *shard_adopt(int cls)
+{
+    shard_page_t *pg;
+
+    MM_LOCK();
+    if ((pg = shard_abandoned[cls]) != NULL)
+        shard_unlink(&shard_abandoned[cls], pg);
+    MM_UNLOCK();
+    if (pg == NULL)
+        return NULL;
+    __atomic_store_n(&pg->owner, shard_tls.id, __ATOMIC_RELAXED);
+    shard_collect(pg); /* 주인이 없는 동안 쌓인 해제 */
+    shard_push(&shard_tls.pages[cls], pg);
+    return pg;
+}
+
+/*
+ * shard_thread_exit - 스레드가 끝날 때 그 스레드의 페이지를 정리.
+ * 빈 페이지는 seg 힙에 돌려주고, 객체가 남은 페이지는 버려진 페이지 리스트로 넘김.
+ * owner를 바꾼 뒤의 해제는 (다른 모든 스레드에게 그랬듯) thread_free로 가므로 잃는 객체가 없음.
+ */
+static void shard_thread_exit(void *arg)
+{
+    (void)arg;
+    if (shard_tls.epoch != __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE))
+        return;
+    for (int cls = 0; cls < SHARD_CLASSES; cls++)
+    {
+        shard_page_t *pg = shard_tls.pages[cls];
+        while (pg != NULL)
+        {
+            shard_page_t *next = pg->next;
+            __atomic_store_n(&pg->owner, SHARD_ABANDONED, __ATOMIC_RELAXED);
+            shard_collect(pg);
+            MM_LOCK();
+            if (pg->used == 0)
+                seg_free(pg);
+            else
+                shard_push(&shard_abandoned[cls], pg);
+            MM_UNLOCK();
+            pg = next;
+        }
+        shard_tls.pages[cls] = NULL;
+    }
+}
+
+static void shard_key_create(void)
+{
+    pthread_key_create(&shard_key, shard_thread_exit);
+}
+
+/*
+ * shard_malloc_slow - head 페이지의 free list가 비었을 때.
+ * 리스트의 페이지들에서 thread_free를 수거해 빈 슬롯이 생긴 페이지를 head로 올리고,
+ * 그래도 없으면 새 페이지를 만듦.
+ */
+static void *shard_malloc_slow(int cls)
+{
+    shard_page_t *pg;
+
+    for (pg = shard_tls.pages[cls]; pg != NULL; pg = pg->next)
+    {
+        shard_collect(pg);
+        if (pg->free != NULL)
+            break;
+    }
+    if (pg == NULL)
+    {
+        /* 버려진 페이지를 먼저 넘겨받고 (빈 슬롯이 없는 것도 이제 이 스레드 소유), 없으면 새 페이지 */
+        while ((pg = shard_adopt(cls)) != NULL && pg->free == NULL)
+            ;
+        if (pg == NULL && (pg = shard_page_new(cls * DSIZE)) == NULL)
+            return NULL;
+    }
+    else if (pg->prev != NULL)
+    {
+        /* head로 옮김 */
+        shard_unlink(&shard_tls.pages[cls], pg);
+        shard_push(&shard_tls.pages[cls], pg);
+    }
+    void *bp = pg->free;
+    pg->free = *(void **)bp;
+    pg->used++;
+    return bp;
+}
+
+/*
+ * shard_malloc - size(1 ~ SHARD_MAX_SIZE)를 현재 스레드의 페이지에서 할당
+ */
+static void *shard_malloc(size_t size)
+{
+    if (shard_tls.epoch != __atomic_load_n(&heap_epoch, __ATOMIC_ACQUIRE))
+    {
+        /* mm_init 이후 처음: 예전 힙의 페이지는 이미 사라졌음 */
+        memset(shard_tls.pages, 0, sizeof(shard_tls.pages));
+        shard_tls.epoch = heap_epoch;
+        if (!shard_tls.registered)
+        {
+            shard_tls.id = __atomic_add_fetch(&shard_next_id, 1, __ATOMIC_RELAXED);
+            pthread_once(&shard_key_once, shard_key_create);
+            pthread_setspecific(shard_key, &shard_tls);
+            shard_tls.registered = 1;
+        }
+    }
+    /* 슬롯 = 헤더 4B + payload(최소 8B, free list 포인터 자리), 8의 배수 */
+    int cls = (size <= DSIZE ? 2 * DSIZE : ALIGN(size + WSIZE)) / DSIZE;
+    shard_page_t *pg = shard_tls.pages[cls];
+    if (pg != NULL && pg->free != NULL)
+    {
+        void *bp = pg->free;
+        pg->free = *(void **)bp;
+        pg->used++;
+        return bp;
+    }
+    return shard_malloc_slow(cls);
+}
+
+/*
+ * shard_free - 페이지 객체 해제. 소유 스레드면 로컬 free list에, 아니면 thread_free에 CAS로 push.
+ * 소유 스레드가 비운 페이지는 그 크기의 유일한 페이지가 아니면 seg 힙에 돌려줌.
+ */
+static void shard_free(void *bp, unsigned int hdr)
+{
+    shard_page_t *pg = (shard_page_t *)((char *)bp - (hdr & ~0x7));
+
+    /* 할당한 적 없는 스레드(id 0)는 어떤 페이지의 소유자와도, 버려진 페이지의 owner와도 같지 않음 */
+    if (__atomic_load_n(&pg->owner, __ATOMIC_RELAXED) != shard_tls.id)
+    {
+        void *head = __atomic_load_n(&pg->thread_free, __ATOMIC_RELAXED);
+        do
+            *(void **)bp = head;
+        while (!__atomic_compare_exchange_n(&pg->thread_free, &head, bp, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        return;
+    }
+
+    *(void **)bp = pg->free;
+    pg->free = bp;
+    if (--pg->used == 0 && (pg->prev != NULL || pg->next != NULL))
+    {
+        shard_unlink(&shard_tls.pages[pg->block_size / DSIZE], pg);
+        MM_LOCK();
+        seg_free(pg);
+        MM_UNLOCK();
+    }
+}
+#endif
+
+#ifdef MM_REGIONS
+/* region_unlink - span s를 클래스의 빈 슬롯 리스트에서 뺌 */
+static void region_unlink(region_span_t *s)
+{
+    if (s->prev != NULL)
+        s->prev->next = s->next;
+    else
+        region_avail[s->cls] = s->next;
+    if (s->next != NULL)
+        s->next->prev = s->prev;
+    s->prev = s->next = NULL;
+}
+
+/* region_push - span s를 클래스의 빈 슬롯 리스트 head에 넣음 */
+static void region_push(region_span_t *s)
+{
+    s->prev = NULL;
+    s->next = region_avail[s->cls];
+    if (s->next != NULL)
+        s->next->prev = s;
+    region_avail[s->cls] = s;
+}
+
+/*
+ * region_span_new - seg 힙에서 payload가 페이지 경계에서 시작하는 한 페이지짜리 블록을 잘라 cls의 새 span으로 만듦.
+ * 페이지 두 개 + MIN_BLOCK_SIZE를 받아 그 안의 페이지 경계에 맞추고, 앞뒤 조각은 빈 블록으로 돌려줌
+ * (앞 조각은 0이거나 MIN_BLOCK_SIZE 이상이 되도록 경계를 고름).
+ */
+static region_span_t *region_span_new(int cls)
+{
+    char *bp = seg_malloc(2 * REGION_PAGE + MIN_BLOCK_SIZE);
+    if (bp == NULL)
+        return NULL;
+
+    size_t size = GET_SIZE(HDRP(bp));
+    size_t off = ((size_t)(bp - heap_listp) + REGION_PAGE - 1) & ~(size_t)(REGION_PAGE - 1);
+    char *sp = heap_listp + off;
+    if (sp != bp && sp - bp < MIN_BLOCK_SIZE)
+        sp += REGION_PAGE;
+    size_t lead = sp - bp;
+    size_t ssize = REGION_PAGE; /* 헤더는 페이지 바로 앞, 푸터는 페이지의 마지막 8바이트 중 앞 4바이트 */
+    size_t trail = size - lead - ssize;
+    if (trail < MIN_BLOCK_SIZE)
+    {
+        ssize += trail; /* 떼어낼 수 없는 꼬리는 span 블록에 붙임 (페이지 밖이라 슬롯으로는 안 씀) */
+        trail = 0;
+    }
+
+    /* span 블록 헤더를 먼저 써야 앞 조각의 coalesce가 다음 블록을 '할당됨'으로 봄 */
+    PUT(HDRP(sp), PACK(ssize, 1));
+    PUT(FTRP(sp), PACK(ssize, 1));
+    if (trail > 0)
+    {
+        char *tp = sp + ssize;
+        PUT(HDRP(tp), PACK(trail, 0));
+        PUT(FTRP(tp), PACK(trail, 0));
+        insert_into_list(coalesce(tp));
+    }
+    if (lead > 0)
+    {
+        PUT(HDRP(bp), PACK(lead, 0));
+        PUT(FTRP(bp), PACK(lead, 0));
+        insert_into_list(coalesce(bp));
+    }
+    heap_gen++;
+
+    size_t page = (sp - heap_listp) / REGION_PAGE;
+    region_span_t *s = &region_spans[page];
+    s->cls = cls;
+    s->used = 0;
+    s->free = NULL;
+    s->bump = 0;
+    region_push(s);
+    if (page >= region_hi)
+        region_hi = page + 1;
+    region_live++;
+    return s;
+}
+
+/*
+ * region_of - bp가 span 안의 객체이면 그 span 정보, 아니면 NULL.
+ * 힙 밖 주소(큰 객체)는 오프셋이 테이블 범위를 벗어나므로 걸러짐.
+ */
+static inline region_span_t *region_of(void *bp)
+{
+    size_t off = (char *)bp - heap_listp;
+    if (off >= (size_t)REGION_PAGES * REGION_PAGE)
+        return NULL;
+    region_span_t *s = &region_spans[off / REGION_PAGE];
+    return s->cls != 0 ? s : NULL;
+}
+
+/*
+ * region_malloc - size(1 ~ REGION_MAX_SIZE)를 클래스의 span에서 할당.
+ * 해제된 슬롯을 먼저 쓰고, 없으면 아직 안 쓴 슬롯을 앞에서부터 잘라 줌.
+ */
+static void *region_malloc(size_t size)
+{
+    int cls = (size + DSIZE - 1) / DSIZE;
+    region_span_t *s = region_avail[cls];
+    char *bp;
+
+    if (s == NULL && (s = region_span_new(cls)) == NULL)
+        return NULL;
+    if (s->free != NULL)
+    {
+        bp = s->free;
+        s->free = *(char **)bp;
+    }
+    else
+    {
+        bp = REGION_ADDR(s) + s->bump;
+        s->bump += cls * DSIZE;
+    }
+    if (++s->used == REGION_CAPACITY(cls))
+        region_unlink(s); /* 꽉 참 */
+    return bp;
+}
+
+/*
+ * region_free - span 객체 해제. 비워진 span은 그 클래스의 유일한 span이 아니면 seg 힙에 돌려주고,
+ * 유일하면 처음 상태로 되돌려 다시 앞에서부터 채움.
+ */
+static void region_free(void *bp, region_span_t *s)
+{
+    if (s->used-- == REGION_CAPACITY(s->cls))
+        region_push(s); /* 꽉 찼던 span에 빈 슬롯이 생김 */
+    if (s->used == 0)
+    {
+        s->free = NULL;
+        s->bump = 0;
+        if (s->prev != NULL || s->next != NULL)
+        {
+            region_unlink(s);
+            s->cls = 0;
+            region_live--;
+            seg_free(REGION_ADDR(s));
+        }
+        return;
+    }
+    *(char **)bp = s->free;
+    s->free = bp;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ * large_malloc - size 바이트짜리 큰 객체를 새 매핑에 할당
+ */
+static void *large_malloc(size_t size)
+{
+    SIM_FUNC(CS_LARGE_MALLOC);
+    size_t len = LARGE_ROUND(size);
+    char *p;
+    int slot;
+
+    if ((p = mem_map(len, &slot)) == NULL)
+        return NULL;
+    p += LARGE_PREFIX;
+    LARGE_LEN(p) = len;
+    LARGE_SLOT(p) = slot;
+    PUT(HDRP(p), LARGE_HDR);
+    STAT_INC(large_maps);
+    return p;
+}
+
+static void large_free(void *bp)
+{
+    SIM_FUNC(CS_LARGE_FREE);
+    mem_unmap(LARGE_SLOT(bp));
+}
+
+/*
+ * large_realloc - 큰 객체 크기 변경. 페이지 수가 같으면 그대로, 다르면 mremap.
+ * 커널은 페이지 테이블 항목만 옮기므로 비용이 바이트 수가 아니라 페이지 수에 비례함.
+ * 작게 줄어도 힙으로 돌아가지 않고 매핑만 줄어듦.
+ */
+static void *large_realloc(void *bp, size_t size)
+{
+    SIM_FUNC(CS_LARGE_REALLOC);
+    size_t len = LARGE_ROUND(size);
+    size_t old_len = LARGE_LEN(bp);
+    char *p;
+
+    if (len == old_len)
+        return bp;
+    if ((p = mem_remap(LARGE_SLOT(bp), len)) == NULL)
+        return NULL;
+    p += LARGE_PREFIX;
+    LARGE_LEN(p) = len;
+    STAT_INC(large_remaps);
+    return p;
+}
+
+/*
+ * mm_malloc / mm_free / mm_realloc - 공개 함수.
+ * 단일 스레드 빌드에서는 seg_*를 그대로 부름 (인라인되어 비용 없음).
+ * MM_THREADS 빌드에서는 작은 블록을 lock-free 스택(MM_TCACHE면 스레드 캐시, MM_SHARDED면
+ * 스레드별 페이지)에서 먼저 찾고,
+ * 나머지는 mm_lock 안에서 seg_*를 부름.
+ * LARGE_MIN 이상은 모든 빌드에서 큰 객체 경로(large_*)로 감. memlib의 매핑 목록도 mm_lock으로 보호.
+ * MM_REGIONS 빌드에서는 REGION_MAX_SIZE 이하가 클래스별 span(region_*)으로 감.
+ * span 객체에는 헤더가 없으므로 mm_free/mm_realloc은 헤더를 읽기 전에 주소로 먼저 가려냄.
+ */
+void *mm_malloc(size_t size)
+{
+    void *bp;
+
+    if (size >= LARGE_MIN)
+    {
+        MM_LOCK();
+        if ((bp = large_malloc(size)) == NULL)
+            bp = seg_malloc(size); /* 매핑 목록이 찼거나 mmap 실패 */
+        MM_UNLOCK();
+        return bp;
+    }
+
+#ifdef MM_SHARDED
+    if (size != 0 && size <= SHARD_MAX_SIZE)
+        return shard_malloc(size);
+#endif
+#ifdef MM_REGIONS
+    if (size != 0 && size <= REGION_MAX_SIZE)
+        return region_malloc(size);
+#endif
+#ifdef MM_LOCKFREE
+    if (size != 0 && size <= LF_MAX_SIZE - DSIZE)
+    {
+        /* seg_malloc과 같은 asize 계산 */
+        size_t asize = (size <= 2 * DSIZE) ? MIN_BLOCK_SIZE : ALIGN(size + DSIZE);
+#ifdef MM_TCACHE
+        return tc_malloc(asize);
+#else
+        if ((bp = lf_pop(asize / DSIZE)) != NULL)
+            return bp;
+#endif
+    }
+#endif
+    MM_LOCK();
+    bp = seg_malloc(size);
+    MM_UNLOCK();
+    return bp;
+}
+
+void mm_free(void *bp)
+{
+#ifdef MM_REGIONS
+    region_span_t *rs;
+    if ((rs = region_of(bp)) != NULL)
+    {
+        region_free(bp, rs);
+        return;
+    }
+#endif
+    if (bp != NULL && IS_LARGE(bp))
+    {
+        MM_LOCK();
+        large_free(bp);
+        MM_UNLOCK();
+        return;
+    }
+#ifdef MM_SHARDED
+    if (bp != NULL && (GET(HDRP(bp)) & SHARD_BIT))
+    {
+        shard_free(bp, GET(HDRP(bp)));
+        return;
+    }
+#endif
+#ifdef MM_LOCKFREE
+    if (bp != NULL)
+    {
+        unsigned int hdr = GET(HDRP(bp));
+        /* 할당 비트만 켜진(샘플링되지 않은) 작은 블록은 병합하지 않고 스택에 넣음 */
+        if ((hdr & 0x7) == 0x1 && (hdr & ~0x7) <= LF_MAX_SIZE)
+        {
+#ifdef MM_TCACHE
+            tc_free(bp, hdr & ~0x7);
+#else
+            lf_push((hdr & ~0x7) / DSIZE, bp);
+#endif
+            return;
+        }
+    }
+#endif
+    MM_LOCK();
+    seg_free(bp);
+    MM_UNLOCK();
+}
+
+void *mm_realloc(void *ptr, size_t size)
+{
+    void *newptr;
+
+    /* 큰 객체, 작은 블록 스택을 거치도록 malloc/free에 해당하는 경우는 공개 함수로 */
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0)
+    {
+        mm_free(ptr);
+        return NULL;
+    }
+#ifdef MM_REGIONS
+    region_span_t *rs;
+    if ((rs = region_of(ptr)) != NULL)
+    {
+        /* span 객체는 슬롯 안에서만 늘고 줄 수 있음. 넘치면 새로 할당해 복사 */
+        size_t capacity = rs->cls * DSIZE;
+        if (size <= capacity)
+            return ptr;
+        if ((newptr = mm_malloc(size)) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, capacity);
+        region_free(ptr, rs);
+        return newptr;
+    }
+#endif
+    unsigned int hdr = GET(HDRP(ptr));
+    if (hdr == LARGE_HDR)
+    {
+        MM_LOCK();
+        newptr = large_realloc(ptr, size);
+        MM_UNLOCK();
+        return newptr;
+    }
+#ifdef MM_SHARDED
+    if (hdr & SHARD_BIT)
+    {
+        /* 페이지 객체는 슬롯 안에서만 늘고 줄 수 있음. 넘치면 새로 할당해 복사 */
+        size_t capacity = ((shard_page_t *)((char *)ptr - (hdr & ~0x7)))->block_size - WSIZE;
+        if (size <= capacity)
+            return ptr;
+        if ((newptr = mm_malloc(size)) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, capacity);
+        mm_free(ptr);
+        return newptr;
+    }
+#endif
+    MM_LOCK();
+    if (size >= LARGE_MIN)
+    {
+        /* 큰 객체가 되는 순간 한 번만 복사해 매핑으로 옮기고, 이후로는 mremap으로 늘림 */
+        if ((newptr = large_malloc(size)) != NULL)
+        {
+            copy_block(newptr, ptr, GET_SIZE(HDRP(ptr)) - DSIZE);
+            seg_free(ptr);
+        }
+        else
+            newptr = seg_realloc(ptr, size); /* 매핑 목록이 찼으면 seg 힙 안에서 */
+    }
+    else
+        newptr = seg_realloc(ptr, size);
+    MM_UNLOCK();
+    return newptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ * 핸들 API - 할당기가 옮길 수 있는 블록.
+ * mm_halloc은 포인터 대신 핸들을 돌려주고, 사용자는 mm_hpin으로 현재 주소를 얻어 쓴 뒤
+ * mm_hunpin으로 놓아줌. pin이 0인 블록은 mm_compact가 앞쪽 빈 블록으로 밀어 옮길 수 있음.
+ * 핸들 블록은 일반 seg 블록 + 헤더의 HANDLE_BIT + payload 앞 8바이트의 핸들 번호.
+ * MM_THREADS 빌드에서는 모든 함수가 mm_lock을 잡으므로 pin 중인 주소는 압축과 경쟁하지 않음.
+ */
+
+/* 핸들 h가 살아있는 핸들이면 1 */
+static int handle_valid(mm_handle_t h)
+{
+    return h != 0 && h < handle_top && handles[h].bp != NULL;
+}
+
+/* 핸들 블록 bp에 번호와 HANDLE_BIT를 기록하고 테이블에 등록 */
+static void handle_attach(mm_handle_t h, char *bp)
+{
+    *(unsigned int *)bp = h;
+    PUT(HDRP(bp), GET(HDRP(bp)) | HANDLE_BIT);
+    handles[h].bp = bp;
+}
+
+/*
+ * mm_halloc - 옮길 수 있는 size 바이트 블록을 할당하고 핸들 반환 (실패 시 0)
+ */
+mm_handle_t mm_halloc(size_t size)
+{
+    mm_handle_t h;
+    char *bp;
+
+    if (size == 0)
+        return 0;
+    MM_LOCK();
+    h = (handle_free != 0) ? handle_free : handle_top;
+    if (h >= MAX_HANDLES || (bp = seg_malloc(size + DSIZE)) == NULL)
+    {
+        MM_UNLOCK();
+        return 0;
+    }
+    if (h == handle_free)
+        handle_free = handles[h].next_free;
+    else
+        handle_top++;
+    handles[h].pins = 0;
+    handle_attach(h, bp);
+    compact_stats.live++;
+    MM_UNLOCK();
+    return h;
+}
+
+/*
+ * mm_hfree - 핸들 블록 해제. 핸들 번호는 재사용됨
+ */
+void mm_hfree(mm_handle_t h)
+{
+    MM_LOCK();
+    if (handle_valid(h))
+    {
+        seg_free(handles[h].bp); /* 헤더를 PACK(size, 0)으로 다시 쓰므로 HANDLE_BIT도 지워짐 */
+        handles[h].bp = NULL;
+        handles[h].next_free = handle_free;
+        handle_free = h;
+        compact_stats.live--;
+    }
+    MM_UNLOCK();
+}
+
+/*
+ * mm_hrealloc - 핸들 블록 크기 변경. 내용은 realloc처럼 보존되고 핸들은 그대로.
+ * pin 중인 블록은 주소가 바뀔 수 있으므로 거부. 성공 시 0, 실패 시 -1
+ */
+int mm_hrealloc(mm_handle_t h, size_t size)
+{
+    char *bp;
+    int ret = -1;
+
+    MM_LOCK();
+    if (handle_valid(h) && handles[h].pins == 0 && size != 0 &&
+        (bp = seg_realloc(handles[h].bp, size + DSIZE)) != NULL)
+    {
+        handle_attach(h, bp); /* seg_realloc이 헤더를 새로 쓰므로 다시 표시 */
+        ret = 0;
+    }
+    MM_UNLOCK();
+    return ret;
+}
+
+/*
+ * mm_hpin - 핸들 블록의 현재 주소 반환. mm_hunpin 전까지는 옮겨지지 않음 (중첩 가능)
+ */
+void *mm_hpin(mm_handle_t h)
+{
+    void *p = NULL;
+
+    MM_LOCK();
+    if (handle_valid(h))
+    {
+        handles[h].pins++;
+        p = handles[h].bp + DSIZE;
+    }
+    MM_UNLOCK();
+    return p;
+}
+
+void mm_hunpin(mm_handle_t h)
+{
+    MM_LOCK();
+    if (handle_valid(h) && handles[h].pins > 0)
+        handles[h].pins--;
+    MM_UNLOCK();
+}
+
+/* 블록 bp를 압축기가 옮길 수 있으면 1 (pin 안 된 핸들 블록. 샘플링된 블록은 프로파일러 기록 때문에 제외) */
+static int compact_movable(char *bp)
+{
+    unsigned int hdr = GET(HDRP(bp));
+    return (hdr & 0x7) == (HANDLE_BIT | 0x1) && handles[*(unsigned int *)bp].pins == 0;
+}
+
+/*
+ * compact_at_tail - bp가 힙의 마지막 할당 블록인지 (뒤가 에필로그이거나 꼬리 빈 블록뿐인지).
+ * 이런 블록은 제자리에서 realloc으로 자랄 수 있는데, 앞으로 밀면 바로 뒤에 작은 블록이 들어와
+ * 다음 realloc이 통째로 복사되고 힙이 두 배가 됨. 옮겨서 얻는 것도 꼬리를 조금 더 자르는 것뿐이라 그대로 둠
+ */
+static int compact_at_tail(char *bp)
+{
+    char *next = NEXT_BLKP(bp);
+
+    if (GET_SIZE(HDRP(next)) == 0)
+        return 1;
+    return !GET_ALLOC(HDRP(next)) && GET_SIZE(HDRP(NEXT_BLKP(next))) == 0;
+}
+
+/*
+ * compact_slide - 빈 블록 bp 바로 뒤의 핸들 블록 next를 bp 자리로 밀어 옮김.
+ * 빈 공간은 옮긴 블록 뒤로 가서 다음 빈 블록과 병합됨. 병합된 빈 블록을 반환
+ */
+static char *compact_slide(char *bp, char *next)
+{
+    size_t fsize = GET_SIZE(HDRP(bp));
+    size_t nsize = GET_SIZE(HDRP(next));
+    char *hole;
+
+    remove_from_list(bp);
+    copy_block(HDRP(bp), HDRP(next), nsize); /* 헤더부터 푸터까지 통째로 (겹칠 수 있음) */
+    handles[*(unsigned int *)bp].bp = bp;
+
+    hole = bp + nsize;
+    PUT(HDRP(hole), PACK(fsize, 0));
+    PUT(FTRP(hole), PACK(fsize, 0));
+    compact_stats.moves++;
+    compact_stats.moved_bytes += nsize;
+    return coalesce(hole); /* 앞은 방금 옮긴 블록(할당됨)이므로 뒤쪽만 병합될 수 있음 */
+}
+
+/*
+ * trim_heap - 힙의 마지막 빈 블록이 2 * CHUNKSIZE 이상이고 힙의 1/MM_TRIM_RATIO 이상이면
+ * 사용 중인 부분의 1/MM_TRIM_RATIO(최소 CHUNKSIZE)만 남기고 brk를 내림 (-DMM_TRIM_RATIO=n).
+ * 꼬리가 조금만 생겨도 자르면 바로 다음 malloc/realloc이 다시 힙을 늘려서, 압축기가 한 바퀴 돌 때마다
+ * 힙이 줄었다 늘었다 함. 그래서 지난번에 자른 뒤 힙이 다시 자랐으면 다음 자르기는 압축 바퀴를
+ * 두 배 더 기다림 (최대 TRIM_MAX_WAIT바퀴). 다시 자라지 않았으면 바로 자름.
+ */
+#ifndef MM_TRIM_RATIO
+#define MM_TRIM_RATIO 4
+#endif
+#define TRIM_MAX_WAIT 64
+static void trim_heap(void)
+{
+    char *bp = PREV_BLKP((char *)mem_heap_hi() + 1); /* 에필로그 바로 앞 블록 */
+    size_t size = GET_SIZE(HDRP(bp));
+    size_t keep = (mem_heapsize() - size) / MM_TRIM_RATIO;
+
+    keep = MAX(ALIGN(keep), CHUNKSIZE);
+    if (GET_ALLOC(HDRP(bp)) || size < 2 * CHUNKSIZE || size < mem_heapsize() / MM_TRIM_RATIO || size < 2 * keep)
+        return;
+    if (trim_brk != 0 && mem_heapsize() > trim_brk)
+    {
+        /* 지난번에 자른 만큼 다시 자람: 기다리는 바퀴 수를 늘리고 한 번 건너뜀 */
+        trim_wait = (2 * trim_wait > TRIM_MAX_WAIT) ? TRIM_MAX_WAIT : 2 * trim_wait;
+        trim_brk = mem_heapsize();
+        trim_passes = 0;
+    }
+    if (++trim_passes < trim_wait)
+        return;
+    if (mem_sbrk(-(int)(size - keep)) == (void *)-1)
+        return;
+    trim_brk = mem_heapsize();
+    trim_passes = 0;
+    remove_from_list(bp);
+    PUT(HDRP(bp), PACK(keep, 0));
+    PUT(FTRP(bp), PACK(keep, 0));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* 새 에필로그 */
+    insert_into_list(bp);
+    compact_stats.trimmed_bytes += size - keep;
+    grow_chunk = grow_last = CHUNKSIZE; /* 줄어든 힙은 다시 작은 단위부터 키움 */
+    grow_mallocs = 0;
+}
+
+/*
+ * mm_compact - 점진적 압축. 힙을 앞에서부터 훑으며 빈 블록 바로 뒤의 옮길 수 있는 핸들 블록을
+ * 앞으로 밀어 빈 공간을 뒤로 모음. 약 budget 바이트를 옮기면 멈추고 다음 호출에서 이어서 함.
+ * 힙 끝까지 가면 남은 꼬리 빈 블록을 잘라냄(trim_heap). 이번 호출에서 옮긴 바이트 수 반환
+ */
+size_t mm_compact(size_t budget)
+{
+    size_t moved = 0;
+    char *bp, *next;
+
+    MM_LOCK();
+    bp = (compact_bp != NULL && compact_gen == heap_gen) ? compact_bp : heap_listp + 4 * WSIZE;
+    while (moved < budget && GET_SIZE(HDRP(bp)) != 0)
+    {
+        next = NEXT_BLKP(bp);
+        if (!GET_ALLOC(HDRP(bp)) && compact_movable(next) && !compact_at_tail(next))
+        {
+            moved += GET_SIZE(HDRP(next));
+            bp = compact_slide(bp, next);
+            insert_into_list(bp);
+        }
+        else
+            bp = next;
+    }
+    if (GET_SIZE(HDRP(bp)) == 0)
+    {
+        trim_heap();
+        compact_bp = NULL; /* 한 바퀴 끝. 다음 호출은 처음부터 */
+    }
+    else
+    {
+        compact_bp = bp;
+        compact_gen = heap_gen;
+    }
+    MM_UNLOCK();
+    return moved;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+/*
+ * mm_ctl - 이름으로 내부 카운터를 조회 (jemalloc의 mallctl과 비슷한 인터페이스)
+ * 예) unsigned long v; mm_ctl("stats.find_fit.visits", &v);
+ *     크기 클래스별 카운터는 "stats.class.<i>.mallocs|frees|reallocs",
+ *     클래스 개수는 "stats.nclasses".
+ *     프로파일러 빌드에서는 "prof.sample_bytes", "prof.dropped"도 조회 가능.
+ *     잠금 프로파일링 빌드에서는 "lock.nlocks", "lock.heap.acquisitions|contended|wait_ns|max_wait_ns",
+ *     "lock.heap.wait_hist.<i>" (잠금을 잡은 함수별 기록은 mm_lock_report로).
+ *     핸들 API와 압축기 카운터 "handle.live", "compact.moves|moved_bytes|trimmed_bytes"는 항상 조회 가능.
+ * 성공 시 0, 모르는 이름이거나 해당 기능 없이 빌드된 경우 -1 반환.
+ */
+int mm_ctl(const char *name, unsigned long *valp)
+{
+#ifdef MM_LOCKPROF
+    /* 잠금 경합 기록: lock.nlocks, lock.<잠금 이름>.<필드> */
+    if (name != NULL && valp != NULL && strncmp(name, "lock.", 5) == 0)
+    {
+        char lock_name[32], lock_field[32];
+        int bucket;
+
+        if (strcmp(name, "lock.nlocks") == 0)
+        {
+            *valp = NUM_LOCKS;
+            return 0;
+        }
+        if (sscanf(name, "lock.%31[^.].%31s", lock_name, lock_field) != 2)
+            return -1;
+        for (int i = 0; i < NUM_LOCKS; i++)
+        {
+            lock_prof_t *lp = lock_profs[i];
+            if (strcmp(lp->name, lock_name) != 0)
+                continue;
+            if (strcmp(lock_field, "acquisitions") == 0)
+                *valp = lp->acquisitions;
+            else if (strcmp(lock_field, "contended") == 0)
+                *valp = lp->contended;
+            else if (strcmp(lock_field, "wait_ns") == 0)
+                *valp = lp->wait_ns;
+            else if (strcmp(lock_field, "max_wait_ns") == 0)
+                *valp = lp->max_wait_ns;
+            else if (sscanf(lock_field, "wait_hist.%d", &bucket) == 1 && bucket >= 0 && bucket < LOCK_HIST_BUCKETS)
+                *valp = lp->wait_hist[bucket];
+            else
+                return -1;
+            return 0;
+        }
+        return -1;
+    }
+#endif
+    /* 핸들 API/압축기 카운터 */
+    if (name != NULL && valp != NULL && (strncmp(name, "handle.", 7) == 0 || strncmp(name, "compact.", 8) == 0))
+    {
+        if (strcmp(name, "handle.live") == 0)
+            *valp = compact_stats.live;
+        else if (strcmp(name, "compact.moves") == 0)
+            *valp = compact_stats.moves;
+        else if (strcmp(name, "compact.moved_bytes") == 0)
+            *valp = compact_stats.moved_bytes;
+        else if (strcmp(name, "compact.trimmed_bytes") == 0)
+            *valp = compact_stats.trimmed_bytes;
+        else
+            return -1;
+        return 0;
+    }
+#ifdef MM_REGIONS
+    /* 클래스별 영역: 살아있는 span 수 */
+    if (name != NULL && valp != NULL && strcmp(name, "region.spans") == 0)
+    {
+        *valp = region_live;
+        return 0;
+    }
+#endif
+#ifdef MM_PROFILE
+    /* 프로파일러 설정/상태: prof.sample_bytes, prof.dropped */
+    if (name != NULL && valp != NULL && strncmp(name, "prof.", 5) == 0)
+    {
+        if (strcmp(name, "prof.sample_bytes") == 0)
+            *valp = PROF_SAMPLE_BYTES;
+        else if (strcmp(name, "prof.dropped") == 0)
+            *valp = prof_dropped;
+        else
+            return -1;
+        return 0;
+    }
+#endif
+#ifdef MM_STATS
+    static const struct
+    {
+        const char *name;
+        unsigned long *counter;
+    } ctl_names[] = {
+        {"stats.find_fit.calls", &mm_stats.find_fit_calls},
+        {"stats.find_fit.visits", &mm_stats.find_fit_visits},
+        {"stats.find_fit.misses", &mm_stats.find_fit_misses},
+        {"stats.coalesce.case1", &mm_stats.coalesce_cases[0]},
+        {"stats.coalesce.case2", &mm_stats.coalesce_cases[1]},
+        {"stats.coalesce.case3", &mm_stats.coalesce_cases[2]},
+        {"stats.coalesce.case4", &mm_stats.coalesce_cases[3]},
+        {"stats.place.splits", &mm_stats.place_splits},
+        {"stats.place.boundary_shifts", &mm_stats.boundary_shifts},
+        {"stats.place.boundary_lead_bytes", &mm_stats.boundary_lead_bytes},
+        {"stats.dv.hits", &mm_stats.dv_hits},
+        {"stats.wild.allocs", &mm_stats.wild_allocs},
+        {"stats.extend_heap.calls", &mm_stats.extend_calls},
+        {"stats.extend_heap.bytes", &mm_stats.extend_bytes},
+        {"stats.realloc.inplace", &mm_stats.realloc_inplace},
+        {"stats.realloc.move", &mm_stats.realloc_move},
+        {"stats.realloc.copy", &mm_stats.realloc_copy},
+        {"stats.realloc.copied_bytes", &mm_stats.realloc_copied_bytes},
+        {"stats.realloc.nt_bytes", &mm_stats.copy_nt_bytes},
+        {"stats.realloc.copy_ns", &mm_stats.copy_ns},
+        {"stats.large.maps", &mm_stats.large_maps},
+        {"stats.large.remaps", &mm_stats.large_remaps},
+    };
+    int index;
+    char field[16];
+
+    if (name == NULL || valp == NULL)
+        return -1;
+
+    if (strcmp(name, "stats.nclasses") == 0)
+    {
+        *valp = NUM_CLASSES;
+        return 0;
+    }
+    /* 크기 클래스별 카운터: stats.class.<i>.<field> */
+    if (sscanf(name, "stats.class.%d.%15s", &index, field) == 2)
+    {
+        if (index < 0 || index >= NUM_CLASSES)
+            return -1;
+        if (strcmp(field, "mallocs") == 0)
+            *valp = mm_stats.mallocs[index];
+        else if (strcmp(field, "frees") == 0)
+            *valp = mm_stats.frees[index];
+        else if (strcmp(field, "reallocs") == 0)
+            *valp = mm_stats.reallocs[index];
+        else
+            return -1;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(ctl_names) / sizeof(ctl_names[0]); i++)
+    {
+        if (strcmp(name, ctl_names[i].name) == 0)
+        {
+            *valp = *ctl_names[i].counter;
+            return 0;
+        }
+    }
+#endif
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef MM_PROFILE
+/*
+ * prof_next_interval - 평균 PROF_SAMPLE_BYTES인 기하(지수) 분포에서 다음 샘플까지의 거리를 뽑음
+ */
+static long prof_next_interval(void)
+{
+    /* xorshift64 */
+    prof_rng ^= prof_rng << 13;
+    prof_rng ^= prof_rng >> 7;
+    prof_rng ^= prof_rng << 17;
+    /* (0, 1] 구간의 균등 난수 u -> -ln(u) * 평균 */
+    double u = ((prof_rng >> 11) + 1) * (1.0 / 9007199254740992.0);
+    return (long)(-log(u) * PROF_SAMPLE_BYTES) + 1;
+}
+
+/*
+ * prof_reset - 모든 사이트/샘플 기록을 지우고 난수 상태를 고정값으로 초기화
+ */
+static void prof_reset(void)
+{
+    memset(prof_sites, 0, sizeof(prof_sites));
+    memset(prof_samples, 0, sizeof(prof_samples));
+    prof_rng = 88172645463325252UL;
+    prof_dropped = 0;
+    prof_countdown = prof_next_interval();
+}
+
+/*
+ * prof_hash - 포인터 배열의 해시 (FNV-1a)
+ */
+static unsigned long prof_hash(void *const *words, int n)
+{
+    unsigned long h = 14695981039346656037UL;
+    for (int i = 0; i < n; i++)
+    {
+        h ^= (unsigned long)words[i];
+        h *= 1099511628211UL;
+    }
+    return h;
+}
+
+/*
+ * prof_find_site - 현재 할당 사이트를 찾거나 새로 등록하고 인덱스 반환 (가득 차면 -1)
+ */
+static int prof_find_site(void)
+{
+    void *stack[PROF_MAX_DEPTH];
+    int depth;
+
+    if (prof_site_id != 0)
+    {
+        stack[0] = (void *)prof_site_id;
+        depth = 1;
+    }
+    else if ((depth = backtrace(stack, PROF_MAX_DEPTH)) <= 0)
+        return -1;
+
+    unsigned long h = prof_hash(stack, depth);
+    for (int n = 0; n < PROF_MAX_SITES; n++)
+    {
+        int i = (h + n) & (PROF_MAX_SITES - 1);
+        prof_site_t *site = &prof_sites[i];
+        if (site->depth == 0)
+        {
+            site->depth = depth;
+            memcpy(site->stack, stack, depth * sizeof(void *));
+            return i;
+        }
+        if (site->depth == depth && memcmp(site->stack, stack, depth * sizeof(void *)) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * prof_lookup - 샘플 블록 bp의 테이블 슬롯 반환 (없으면 NULL)
+ */
+static prof_sample_t *prof_lookup(void *bp)
+{
+    unsigned long h = prof_hash(&bp, 1);
+    for (int n = 0; n < PROF_MAX_SAMPLES; n++)
+    {
+        prof_sample_t *s = &prof_samples[(h + n) & (PROF_MAX_SAMPLES - 1)];
+        if (s->bp == bp)
+            return s;
+        if (s->bp == NULL)
+            return NULL;
+    }
+    return NULL;
+}
+
+/*
+ * prof_attach - 블록 bp(요청 크기 size)를 site의 샘플로 기록하고 헤더에 PROF_BIT 설정
+ */
+static void prof_attach(void *bp, size_t size, int site_index)
+{
+    unsigned long h = prof_hash(&bp, 1);
+    prof_site_t *site = &prof_sites[site_index];
+
+    for (int n = 0; n < PROF_MAX_SAMPLES; n++)
+    {
+        prof_sample_t *s = &prof_samples[(h + n) & (PROF_MAX_SAMPLES - 1)];
+        if (s->bp == NULL || s->bp == PROF_TOMBSTONE)
+        {
+            s->bp = bp;
+            s->size = size;
+            s->site = site_index;
+            site->live_objs++;
+            site->live_bytes += size;
+            if (site->live_bytes > site->peak_bytes)
+                site->peak_bytes = site->live_bytes;
+            PUT(HDRP(bp), GET(HDRP(bp)) | PROF_BIT);
+            return;
+        }
+    }
+    prof_dropped++;
+}
+
+/*
+ * prof_detach - 샘플 기록을 지우고 사이트의 live 통계를 차감. 기록이 있던 사이트 인덱스 반환.
+ */
+static int prof_detach(void *bp, size_t *sizep)
+{
+    prof_sample_t *s = prof_lookup(bp);
+    PUT(HDRP(bp), GET(HDRP(bp)) & ~PROF_BIT);
+    if (s == NULL)
+        return -1;
+
+    prof_site_t *site = &prof_sites[s->site];
+    site->live_objs--;
+    site->live_bytes -= s->size;
+    *sizep = s->size;
+    s->bp = PROF_TOMBSTONE;
+    return s->site;
+}
+
+/*
+ * prof_sample - 카운트다운이 끝난 할당 하나를 샘플링
+ */
+static void prof_sample(void *bp, size_t size)
+{
+    prof_countdown = prof_next_interval();
+
+    int site_index = prof_find_site();
+    if (site_index < 0)
+    {
+        prof_dropped++;
+        return;
+    }
+    prof_sites[site_index].alloc_objs++;
+    prof_sites[site_index].alloc_bytes += size;
+    prof_attach(bp, size, site_index);
+}
+
+/*
+ * prof_unsample - 샘플링된 블록이 해제될 때 호출
+ */
+static void prof_unsample(void *bp)
+{
+    size_t size;
+    prof_detach(bp, &size);
+}
+
+/*
+ * prof_realloc - 샘플링된 블록의 realloc. 기록을 떼어낸 뒤 일반 seg_realloc을 수행하고,
+ * 결과 블록에 같은 사이트로 다시 붙임 (결과 블록이 새로 샘플링됐다면 그 기록을 유지).
+ */
+static void *prof_realloc(void *ptr, size_t size)
+{
+    size_t old_size;
+    int site_index = prof_detach(ptr, &old_size);
+    void *newptr = seg_realloc(ptr, size);
+
+    if (newptr == NULL)
+    {
+        if (site_index >= 0) /* 실패하면 이전 블록이 그대로 남음 */
+            prof_attach(ptr, old_size, site_index);
+        return NULL;
+    }
+    if (site_index >= 0 && !(GET(HDRP(newptr)) & PROF_BIT))
+        prof_attach(newptr, size, site_index);
+    return newptr;
+}
+#endif
+
+/*
+ * mm_prof_set_site - 이후 할당의 사이트 id를 지정 (0이면 backtrace로 사이트를 구함).
+ * mdriver처럼 호출 스택이 의미 없는 곳에서 사이트를 직접 넘길 때 사용.
+ */
+void mm_prof_set_site(unsigned long site)
+{
+#ifdef MM_PROFILE
+    prof_site_id = site;
+#endif
+}
+
+/*
+ * mm_prof_dump - 샘플링된 힙 프로파일을 pprof의 heap_v2 텍스트 형식으로 출력
+ * (사이트별 live 샘플 수/바이트 [누적 샘플 수/바이트] @ 스택). 프로파일러가 없으면 -1 반환.
+ */
+int mm_prof_dump(FILE *fp)
+{
+#ifdef MM_PROFILE
+    unsigned long live_objs = 0, live_bytes = 0, alloc_objs = 0, alloc_bytes = 0;
+    FILE *maps;
+    char line[512];
+
+    for (int i = 0; i < PROF_MAX_SITES; i++)
+    {
+        live_objs += prof_sites[i].live_objs;
+        live_bytes += prof_sites[i].live_bytes;
+        alloc_objs += prof_sites[i].alloc_objs;
+        alloc_bytes += prof_sites[i].alloc_bytes;
+    }
+    fprintf(fp, "heap profile: %lu: %lu [%lu: %lu] @ heap_v2/%d\n",
+            live_objs, live_bytes, alloc_objs, alloc_bytes, PROF_SAMPLE_BYTES);
+    for (int i = 0; i < PROF_MAX_SITES; i++)
+    {
+        prof_site_t *site = &prof_sites[i];
+        if (site->depth == 0)
+            continue;
+        fprintf(fp, "%lu: %lu [%lu: %lu] @", site->live_objs, site->live_bytes,
+                site->alloc_objs, site->alloc_bytes);
+        for (int d = 0; d < site->depth; d++)
+            fprintf(fp, " %p", site->stack[d]);
+        fprintf(fp, "\n");
+    }
+
+    /* pprof가 주소를 심볼로 바꿀 수 있도록 메모리 맵을 덧붙임 */
+    fprintf(fp, "\nMAPPED_LIBRARIES:\n");
+    if ((maps = fopen("/proc/self/maps", "r")) != NULL)
+    {
+        while (fgets(line, sizeof(line), maps) != NULL)
+            fputs(line, fp);
+        fclose(maps);
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * mm_prof_report - 사이트별 live/peak 바이트를 peak 순으로 최대 top개 출력 (사람이 읽는 용도).
+ * 프로파일러가 없으면 -1 반환.
+ */
+int mm_prof_report(FILE *fp, int top)
+{
+#ifdef MM_PROFILE
+    unsigned char shown[PROF_MAX_SITES] = {0};
+
+    fprintf(fp, "  %-20s%10s%12s%12s%12s\n", "site", "samples", "live", "peak", "allocated");
+    for (int n = 0; n < top; n++)
+    {
+        int best = -1;
+        for (int i = 0; i < PROF_MAX_SITES; i++)
+        {
+            if (prof_sites[i].depth == 0 || shown[i])
+                continue;
+            if (best < 0 || prof_sites[i].peak_bytes > prof_sites[best].peak_bytes)
+                best = i;
+        }
+        if (best < 0)
+            break;
+        shown[best] = 1;
+        prof_site_t *site = &prof_sites[best];
+        fprintf(fp, "  %-20p%10lu%12lu%12lu%12lu\n", site->stack[0], site->alloc_objs,
+                site->live_bytes, site->peak_bytes, site->alloc_bytes);
+    }
+    if (prof_dropped)
+        fprintf(fp, "  (%lu samples dropped: tables full)\n", prof_dropped);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * mm_lock_report - 잠금별 경합 기록을 표로 출력 (사람이 읽는 용도).
+ * 잠금 프로파일링 없이 빌드됐으면 -1 반환.
+ */
+int mm_lock_report(FILE *fp)
+{
+#ifdef MM_LOCKPROF
+    for (int i = 0; i < NUM_LOCKS; i++)
+    {
+        lock_prof_t *lp = lock_profs[i];
+
+        fprintf(fp, "  lock %s: %lu acquisitions, %lu contended (%.2f%%), wait %lu ns (max %lu ns)\n",
+                lp->name, lp->acquisitions, lp->contended,
+                lp->acquisitions ? 100.0 * lp->contended / lp->acquisitions : 0.0,
+                lp->wait_ns, lp->max_wait_ns);
+        for (int b = 0; b < LOCK_HIST_BUCKETS; b++)
+        {
+            if (lp->wait_hist[b])
+                fprintf(fp, "    wait [%10lu, %10lu) ns %10lu\n", 1UL << b, 2UL << b, lp->wait_hist[b]);
+        }
+        fprintf(fp, "    %-20s%14s%10s%14s\n", "holder", "acquisitions", "blocked", "blocked_ns");
+        for (int h = 0; h < LOCK_MAX_HOLDERS && lp->holders[h].func != NULL; h++)
+        {
+            lock_holder_t *holder = &lp->holders[h];
+            fprintf(fp, "    %-20s%14lu%10lu%14lu\n", holder->func, holder->acquisitions,
+                    holder->blocked, holder->blocked_ns);
+        }
+    }
+    return 0;
+#else
+    return -1;
+#endif
+}
@@ -1,3 +1,6 @@
+#ifndef __MM_H_
+#define __MM_H_
+
 #include <stdio.h>
 
 extern int mm_init (void);
@@ -5,6 +8,40 @@ extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
 extern void *mm_realloc(void *ptr, size_t size);
 
+/* Query an internal counter by name, e.g. "stats.find_fit.visits".
+   Returns 0 on success, -1 if unknown (or mm.c built without MM_STATS). */
+extern int mm_ctl(const char *name, unsigned long *valp);
+
+/* Sampling heap profiler (mm.c built with MM_PROFILE). A nonzero site id
+   replaces the backtrace as the allocation site of following mallocs.
+   mm_prof_dump writes a pprof heap_v2 text profile; mm_prof_report prints
+   the top sites by peak sampled bytes. Both return -1 when compiled out. */
+extern void mm_prof_set_site(unsigned long site);
+extern int mm_prof_dump(FILE *fp);
+extern int mm_prof_report(FILE *fp, int top);
+
+/* Lock contention report (mm.c built with MM_THREADS and MM_LOCKPROF):
+   acquisitions, contended acquisitions, wait time histogram and the
+   functions holding each lock. Returns -1 when compiled out. */
+extern int mm_lock_report(FILE *fp);
+
+/* Movable blocks. mm_halloc returns a handle (0 on failure) to a block the
+   allocator may relocate; mm_hpin returns its current address and keeps it
+   in place until the matching mm_hunpin. mm_hrealloc resizes an unpinned
+   block (0 on success, -1 on failure). mm_compact slides unpinned handle
+   blocks toward the start of the heap, stopping after about budget bytes
+   moved (the next call resumes), trims the free tail of the heap when it
+   is a large part of the heap (less often if the heap keeps growing back)
+   and returns the number of bytes moved. The last block of the heap is
+   left in place so that it can still grow in place. */
+typedef unsigned int mm_handle_t;
+extern mm_handle_t mm_halloc(size_t size);
+extern void mm_hfree(mm_handle_t h);
+extern int mm_hrealloc(mm_handle_t h, size_t size);
+extern void *mm_hpin(mm_handle_t h);
+extern void mm_hunpin(mm_handle_t h);
+extern size_t mm_compact(size_t budget);
+
 
 /* 
  * Students work in teams of one or two.  Teams enter their team name, 
@@ -21,3 +58,4 @@ typedef struct {
 
 extern team_t team;
 
+#endif /* __MM_H_ */
@@ -0,0 +1,453 @@
+/*
+ * mm.hpp - header-only C++ version of the mm.c segregated-fit allocator
+ *
+ * mm::heap<> is the same design as mm.c (boundary tags, segregated
+ * explicit free lists, LIFO insertion, coalescing on free, realloc that
+ * grows into free neighbours or at the end of the heap), but its
+ * layout and policies are template parameters, so every branch on them
+ * is resolved at compile time:
+ *
+ *   Align        payload alignment and block size granularity (8, 16, ...)
+ *   Header       header/footer word type (std::uint32_t or std::uint64_t)
+ *   ClassLimits  constexpr array with the largest block size of each size
+ *                class but the last; the class of a size is looked up in
+ *                a table built at compile time
+ *   Fit          fit_policy::best_fit (as mm.c) or fit_policy::first_fit
+ *   Footer       footer_policy::all_blocks (as mm.c) or
+ *                footer_policy::free_blocks_only, where allocated blocks
+ *                have no footer and each header keeps a prev-allocated bit
+ *   Source       where memory comes from: a type with a static
+ *                void *sbrk(std::size_t) (default: memlib's mem_sbrk)
+ *   ChunkSize    minimum heap extension in bytes
+ *
+ * A heap owns its Source: the memory it returns must be contiguous,
+ * start Align-aligned, and not be shared with another heap.
+ * mm_cpp.cc wraps one instance in the extern "C" functions of mm.h.
+ */
+#ifndef __MM_HPP_
+#define __MM_HPP_
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+extern "C"
+{
+#include "memlib.h"
+}
+
+namespace mm
+{
+
+enum class fit_policy
+{
+    first_fit,
+    best_fit
+};
+
+enum class footer_policy
+{
+    all_blocks,
+    free_blocks_only
+};
+
+/* The size class boundaries of mm.c (see mm_classes.h) */
+inline constexpr std::array<std::size_t, 9> default_class_limits = {
+    31, 63, 127, 255, 511, 1023, 2047, 4095, 8191};
+
+/* Default memory source: the memlib model of sbrk */
+struct memlib_source
+{
+    static void *sbrk(std::size_t bytes)
+    {
+        void *p = mem_sbrk((int)bytes);
+        return p == (void *)-1 ? nullptr : p;
+    }
+};
+
+/*
+ * make_class_table - size class of every block size up to the last limit,
+ *     indexed by size / Align (block sizes are multiples of Align)
+ */
+template <const auto &Limits, std::size_t Align>
+constexpr auto make_class_table()
+{
+    constexpr std::size_t n = Limits.size();
+    std::array<std::uint8_t, Limits[n - 1] / Align + 1> table{};
+    for (std::size_t i = 0; i < table.size(); i++)
+    {
+        std::size_t c = 0;
+        while (c < n && i * Align > Limits[c])
+            c++;
+        table[i] = (std::uint8_t)c;
+    }
+    return table;
+}
+
+template <std::size_t Align = 8,
+          typename Header = std::uint32_t,
+          const auto &ClassLimits = default_class_limits,
+          fit_policy Fit = fit_policy::best_fit,
+          footer_policy Footer = footer_policy::all_blocks,
+          typename Source = memlib_source,
+          std::size_t ChunkSize = (1 << 12)>
+class heap
+{
+    static_assert(Align >= 8 && (Align & (Align - 1)) == 0, "Align must be a power of two >= 8");
+    static_assert(sizeof(Header) == 4 || sizeof(Header) == 8, "Header must be 4 or 8 bytes");
+    static_assert(ClassLimits.size() >= 1 && ClassLimits.size() < 255, "bad size class table");
+
+    static constexpr std::size_t WSIZE = sizeof(Header);
+    static constexpr Header ALLOC = 0x1;      /* block is allocated */
+    static constexpr Header PREV_ALLOC = 0x2; /* previous block is allocated (free_blocks_only) */
+    static constexpr Header FLAGS = 0x7;
+    static constexpr bool alloc_footers = (Footer == footer_policy::all_blocks);
+    static constexpr std::size_t num_classes = ClassLimits.size() + 1;
+
+    static constexpr std::size_t round_up(std::size_t n)
+    {
+        return (n + Align - 1) & ~(Align - 1);
+    }
+
+    /* header + prev/next links + footer */
+    static constexpr std::size_t min_block = round_up(2 * WSIZE + 2 * sizeof(void *));
+    /* the prologue is an allocated block with a header and a footer */
+    static constexpr std::size_t prologue_size = round_up(2 * WSIZE);
+    /* padding that makes the first payload (after the epilogue header) aligned */
+    static constexpr std::size_t pad = (Align - (prologue_size + WSIZE) % Align) % Align;
+    /* bytes a block needs besides its payload */
+    static constexpr std::size_t overhead = alloc_footers ? 2 * WSIZE : WSIZE;
+
+    static constexpr auto class_table = make_class_table<ClassLimits, Align>();
+
+public:
+    static constexpr std::size_t alignment = Align;
+
+    /*
+     * init - create an empty heap; same role as mm_init. Returns 0 or -1.
+     */
+    int init()
+    {
+        char *p = (char *)Source::sbrk(pad + prologue_size + WSIZE);
+        if (p == nullptr)
+            return -1;
+        p += pad;
+        word(p) = prologue_size | ALLOC | PREV_ALLOC;                          /* prologue header */
+        word(p + prologue_size - WSIZE) = prologue_size | ALLOC | PREV_ALLOC;  /* prologue footer */
+        word(p + prologue_size) = 0 | ALLOC | PREV_ALLOC;                      /* epilogue header */
+        for (std::size_t i = 0; i < num_classes; i++)
+            roots[i] = nullptr;
+        return extend(ChunkSize) == nullptr ? -1 : 0;
+    }
+
+    void *malloc(std::size_t size)
+    {
+        if (size == 0)
+            return nullptr;
+        std::size_t asize = adjust(size);
+        char *bp = find_fit(asize);
+        if (bp == nullptr && (bp = extend(asize > ChunkSize ? asize : ChunkSize)) == nullptr)
+            return nullptr;
+        place(bp, asize);
+        return bp;
+    }
+
+    void free(void *ptr)
+    {
+        char *bp = (char *)ptr;
+        if (bp == nullptr || !(word(hdrp(bp)) & ALLOC))
+            return;
+        set_header(bp, block_size(bp), false);
+        set_footer(bp);
+        set_prev_alloc(next_blkp(bp), false);
+        insert(coalesce(bp));
+    }
+
+    /*
+     * free with the payload size known to the caller (C++ sized deallocation).
+     * Coalescing still reads the boundary tags, so the size is only checked.
+     */
+    void free(void *ptr, std::size_t size)
+    {
+        assert(ptr == nullptr || adjust(size) <= block_size(ptr));
+        (void)size;
+        free(ptr);
+    }
+
+    void *realloc(void *ptr, std::size_t size)
+    {
+        char *bp = (char *)ptr;
+        if (size == 0)
+        {
+            free(bp);
+            return nullptr;
+        }
+        if (bp == nullptr)
+            return malloc(size);
+
+        std::size_t asize = adjust(size);
+        std::size_t old_size = block_size(bp);
+
+        /* shrink: split off the tail if it can be a block of its own */
+        if (asize <= old_size)
+        {
+            if (old_size - asize >= min_block)
+            {
+                split_allocated(bp, asize, old_size);
+                char *rest = next_blkp(bp);
+                set_prev_alloc(next_blkp(rest), false);
+                insert(coalesce(rest));
+            }
+            return bp;
+        }
+
+        char *next = next_blkp(bp);
+        std::size_t next_size = block_size(next);
+
+        /* last block: grow the heap by exactly the missing bytes */
+        if (next_size == 0 && Source::sbrk(asize - old_size) != nullptr)
+        {
+            set_header(bp, asize, true);
+            set_footer(bp);
+            word(hdrp(next_blkp(bp))) = 0 | ALLOC | PREV_ALLOC; /* new epilogue */
+            return bp;
+        }
+
+        /* the next block is free and large enough: absorb it */
+        if (!(word(hdrp(next)) & ALLOC) && old_size + next_size >= asize)
+        {
+            std::size_t combined = old_size + next_size;
+            remove(next);
+            if (combined - asize >= min_block)
+            {
+                split_allocated(bp, asize, combined);
+                insert(next_blkp(bp)); /* its successor is allocated: nothing to merge */
+            }
+            else
+            {
+                set_header(bp, combined, true);
+                set_footer(bp);
+                set_prev_alloc(next_blkp(bp), true);
+            }
+            return bp;
+        }
+
+        /* the previous block (and if needed the next one) is free: slide the payload down */
+        if (!prev_allocated(bp))
+        {
+            char *prev = prev_blkp(bp);
+            std::size_t combined = old_size + block_size(prev);
+            bool take_next = !(word(hdrp(next)) & ALLOC) && combined < asize;
+            if (take_next)
+                combined += next_size;
+            if (combined >= asize)
+            {
+                remove(prev);
+                if (take_next)
+                    remove(next);
+                std::memmove(prev, bp, old_size - overhead);
+                set_header(prev, combined, true);
+                set_footer(prev);
+                if (combined - asize >= min_block)
+                {
+                    split_allocated(prev, asize, combined);
+                    char *rest = next_blkp(prev);
+                    set_prev_alloc(next_blkp(rest), false);
+                    insert(coalesce(rest));
+                }
+                else
+                    set_prev_alloc(next_blkp(prev), true);
+                return prev;
+            }
+        }
+
+        /* last resort: allocate, copy, free */
+        char *newp = (char *)malloc(size);
+        if (newp == nullptr)
+            return nullptr;
+        std::size_t copy = old_size - overhead;
+        std::memcpy(newp, bp, size < copy ? size : copy);
+        free(bp);
+        return newp;
+    }
+
+private:
+    void *roots[num_classes]; /* head of each size class free list */
+
+    /* --- block layout --- */
+    static Header &word(void *p) { return *(Header *)p; }
+    static char *hdrp(void *bp) { return (char *)bp - WSIZE; }
+    static std::size_t block_size(void *bp) { return word(hdrp(bp)) & ~FLAGS; }
+    static char *ftrp(void *bp) { return (char *)bp + block_size(bp) - 2 * WSIZE; }
+    static char *next_blkp(void *bp) { return (char *)bp + block_size(bp); }
+    /* only valid when the previous block has a footer */
+    static char *prev_blkp(void *bp) { return (char *)bp - (word((char *)bp - 2 * WSIZE) & ~FLAGS); }
+
+    static void *&prev_free(void *bp) { return *(void **)bp; }
+    static void *&next_free(void *bp) { return *(void **)((char *)bp + sizeof(void *)); }
+
+    static bool prev_allocated(void *bp)
+    {
+        if constexpr (alloc_footers)
+            return word((char *)bp - 2 * WSIZE) & ALLOC;
+        else
+            return word(hdrp(bp)) & PREV_ALLOC;
+    }
+
+    /* write bp's header, keeping its prev-allocated bit */
+    static void set_header(void *bp, std::size_t size, bool alloc)
+    {
+        Header prev = alloc_footers ? 0 : (word(hdrp(bp)) & PREV_ALLOC);
+        word(hdrp(bp)) = (Header)size | (alloc ? ALLOC : 0) | prev;
+    }
+
+    /* copy the header to the footer, if this block has one */
+    static void set_footer(void *bp)
+    {
+        if (alloc_footers || !(word(hdrp(bp)) & ALLOC))
+            word(ftrp(bp)) = word(hdrp(bp));
+    }
+
+    static void set_prev_alloc(void *bp, bool alloc)
+    {
+        if constexpr (!alloc_footers)
+        {
+            if (alloc)
+                word(hdrp(bp)) |= PREV_ALLOC;
+            else
+                word(hdrp(bp)) &= ~PREV_ALLOC;
+        }
+    }
+
+    /* block size for a request of size payload bytes */
+    static std::size_t adjust(std::size_t size)
+    {
+        std::size_t asize = round_up(size + overhead);
+        return asize < min_block ? min_block : asize;
+    }
+
+    /* make bp (currently size bytes, allocated) asize bytes and mark the rest free */
+    static void split_allocated(char *bp, std::size_t asize, std::size_t size)
+    {
+        set_header(bp, asize, true);
+        set_footer(bp);
+        char *rest = next_blkp(bp);
+        word(hdrp(rest)) = (Header)(size - asize) | PREV_ALLOC;
+        set_footer(rest);
+    }
+
+    /* --- size classes and free lists --- */
+    static std::size_t class_index(std::size_t size)
+    {
+        return size / Align < class_table.size() ? class_table[size / Align] : num_classes - 1;
+    }
+
+    void insert(char *bp)
+    {
+        void *&root = roots[class_index(block_size(bp))];
+        next_free(bp) = root;
+        if (root != nullptr)
+            prev_free(root) = bp;
+        prev_free(bp) = nullptr;
+        root = bp;
+    }
+
+    void remove(char *bp)
+    {
+        void *prev = prev_free(bp);
+        void *next = next_free(bp);
+        if (prev == nullptr)
+            roots[class_index(block_size(bp))] = next;
+        else
+            next_free(prev) = next;
+        if (next != nullptr)
+            prev_free(next) = prev;
+    }
+
+    char *find_fit(std::size_t asize)
+    {
+        char *best = nullptr;
+        std::size_t best_diff = (std::size_t)-1;
+
+        for (std::size_t i = class_index(asize); i < num_classes; i++)
+        {
+            for (char *bp = (char *)roots[i]; bp != nullptr; bp = (char *)next_free(bp))
+            {
+                std::size_t size = block_size(bp);
+                if (size < asize)
+                    continue;
+                if constexpr (Fit == fit_policy::first_fit)
+                    return bp;
+                if (size - asize < best_diff)
+                {
+                    best_diff = size - asize;
+                    best = bp;
+                    if (best_diff == 0)
+                        return best;
+                }
+            }
+        }
+        return best;
+    }
+
+    void place(char *bp, std::size_t asize)
+    {
+        std::size_t size = block_size(bp);
+        remove(bp);
+        if (size - asize >= min_block)
+        {
+            split_allocated(bp, asize, size);
+            insert(next_blkp(bp));
+        }
+        else
+        {
+            set_header(bp, size, true);
+            set_footer(bp);
+            set_prev_alloc(next_blkp(bp), true);
+        }
+    }
+
+    char *coalesce(char *bp)
+    {
+        bool prev_alloc = prev_allocated(bp);
+        char *next = next_blkp(bp);
+        bool next_alloc = word(hdrp(next)) & ALLOC;
+        std::size_t size = block_size(bp);
+
+        if (!next_alloc)
+        {
+            remove(next);
+            size += block_size(next);
+        }
+        if (!prev_alloc)
+        {
+            bp = prev_blkp(bp);
+            remove(bp);
+            size += block_size(bp);
+        }
+        set_header(bp, size, false);
+        set_footer(bp);
+        return bp;
+    }
+
+    char *extend(std::size_t bytes)
+    {
+        std::size_t size = round_up(bytes < min_block ? min_block : bytes);
+        char *bp = (char *)Source::sbrk(size);
+        if (bp == nullptr)
+            return nullptr;
+        /* the old epilogue header becomes the new block's header */
+        set_header(bp, size, false);
+        set_footer(bp);
+        word(hdrp(next_blkp(bp))) = 0 | ALLOC; /* new epilogue */
+        bp = coalesce(bp);
+        insert(bp);
+        return bp;
+    }
+};
+
+} // namespace mm
+
+#endif /* __MM_HPP_ */
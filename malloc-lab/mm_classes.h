@@ -0,0 +1,14 @@
+/*
+ * mm_classes.h - size class table compiled into mm.c
+ *
+ * MM_CLASS_LIMITS lists the largest block size (bytes) of every class
+ * except the last one, which takes all larger blocks. Regenerate it for
+ * a trace set with "make tune-classes" (see classtune.c).
+ */
+#ifndef __MM_CLASSES_H_
+#define __MM_CLASSES_H_
+
+#define MM_NUM_CLASSES 10
+#define MM_CLASS_LIMITS {31, 63, 127, 255, 511, 1023, 2047, 4095, 8191}
+
+#endif /* __MM_CLASSES_H_ */
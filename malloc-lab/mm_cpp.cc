@@ -0,0 +1,100 @@
+/*
+ * mm_cpp.cc - the mm.h interface on top of the C++ template allocator
+ *
+ * Builds mdriver against one mm::heap instance (make mdriver-cpp). The
+ * heap type can be changed at compile time, e.g.
+ *   -DMM_CPP_HEAP='mm::heap<16, std::uint64_t>'
+ */
+#include "mm.hpp"
+
+extern "C"
+{
+#include "mm.h"
+}
+
+#ifndef MM_CPP_HEAP
+#define MM_CPP_HEAP mm::heap<>
+#endif
+
+static char team_name[] = "ateam (segregated-fit, C++ template)";
+static char member_name[] = "Harry Bovik";
+static char member_id[] = "bovik@cs.cmu.edu";
+static char empty[] = "";
+
+team_t team = {team_name, member_name, member_id, empty, empty};
+
+static MM_CPP_HEAP heap;
+
+extern "C" int mm_init(void)
+{
+    return heap.init();
+}
+
+extern "C" void *mm_malloc(size_t size)
+{
+    return heap.malloc(size);
+}
+
+extern "C" void mm_free(void *ptr)
+{
+    heap.free(ptr);
+}
+
+extern "C" void *mm_realloc(void *ptr, size_t size)
+{
+    return heap.realloc(ptr, size);
+}
+
+/* The counters, the profilers, the lock report and the movable handle
+   blocks only exist in mm.c */
+extern "C" int mm_ctl(const char *name, unsigned long *valp)
+{
+    return -1;
+}
+
+extern "C" void mm_prof_set_site(unsigned long site)
+{
+}
+
+extern "C" int mm_prof_dump(FILE *fp)
+{
+    return -1;
+}
+
+extern "C" int mm_prof_report(FILE *fp, int top)
+{
+    return -1;
+}
+
+extern "C" int mm_lock_report(FILE *fp)
+{
+    return -1;
+}
+
+extern "C" mm_handle_t mm_halloc(size_t size)
+{
+    return 0;
+}
+
+extern "C" void mm_hfree(mm_handle_t h)
+{
+}
+
+extern "C" int mm_hrealloc(mm_handle_t h, size_t size)
+{
+    return -1;
+}
+
+extern "C" void *mm_hpin(mm_handle_t h)
+{
+    return NULL;
+}
+
+extern "C" void mm_hunpin(mm_handle_t h)
+{
+}
+
+extern "C" size_t mm_compact(size_t budget)
+{
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * mm_fast.h - inline fast paths for small mm_malloc/mm_free calls
+ *
+ * Freed blocks whose payload is at most MM_FAST_MAX bytes are kept, still
+ * marked allocated, on a per-size-class LIFO cache (one list per 8-byte
+ * payload class, at most MM_FAST_DEPTH blocks each). mm_fast_malloc pops
+ * from the cache and mm_fast_free pushes onto it; everything else (cache
+ * misses, full caches, larger sizes, profiler-sampled blocks) falls
+ * through to the out-of-line functions in mm.c. When the size is a
+ * compile-time constant the class computation folds away, so a hit costs
+ * a compare, a load and a store.
+ *
+ * The caches belong to mm.c and are emptied by mm_init. Cached blocks stay
+ * allocated as far as the rest of the heap is concerned, so they are not
+ * coalesced until they are handed out and freed with plain mm_free.
+ */
+#ifndef __MM_FAST_H_
+#define __MM_FAST_H_
+
+#include <stddef.h>
+#include "mm.h"
+
+#define MM_FAST_MAX 64   /* largest payload served from the caches */
+#define MM_FAST_DEPTH 64 /* max cached blocks per class */
+
+/* class = payload capacity in 8-byte words; payloads <= 16 share the minimum block */
+#define MM_FAST_CLASSES (MM_FAST_MAX / 8 + 1)
+#define MM_FAST_CLASS(size) ((size) <= 16 ? 2 : ((size) + 7) >> 3)
+
+extern void *mm_fast_cache[MM_FAST_CLASSES];
+extern unsigned int mm_fast_count[MM_FAST_CLASSES];
+
+static inline void *mm_fast_malloc(size_t size)
+{
+    if (size != 0 && size <= MM_FAST_MAX)
+    {
+        size_t cls = MM_FAST_CLASS(size);
+        void *bp = mm_fast_cache[cls];
+        if (bp != NULL)
+        {
+            mm_fast_cache[cls] = *(void **)bp;
+            mm_fast_count[cls]--;
+            return bp;
+        }
+    }
+    return mm_malloc(size);
+}
+
+static inline void mm_fast_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        /* 4-byte header: block size | page object or handle (0x4) | sampled (0x2) | alloc (0x1);
+           0x7 with size 0 is a large object mapped outside the heap */
+        unsigned int hdr = *(unsigned int *)((char *)ptr - 4);
+        size_t payload = (hdr & ~0x7u) - 8;
+        if ((hdr & 0x7) == 0x1 && payload <= MM_FAST_MAX)
+        {
+            size_t cls = payload >> 3;
+            if (mm_fast_count[cls] < MM_FAST_DEPTH)
+            {
+                *(void **)ptr = mm_fast_cache[cls];
+                mm_fast_cache[cls] = ptr;
+                mm_fast_count[cls]++;
+                return;
+            }
+        }
+    }
+    mm_free(ptr);
+}
+
+#endif /* __MM_FAST_H_ */
@@ -0,0 +1,184 @@
+/*
+ * mm_stl.hpp - C++ standard library adapters over an mm::heap (mm.hpp)
+ *
+ *   mm::allocator<T, Heap>      satisfies the Allocator requirements;
+ *                               deallocate(p, n) calls the sized free
+ *   mm::heap_resource<Heap>     std::pmr::memory_resource over a heap
+ *   mm::pool_resource<Heap>     std::pmr::memory_resource that keeps
+ *                               freed small blocks in per-size-class
+ *                               caches and only goes to the heap on a miss
+ *
+ * The adapters hold a reference to the heap, which must outlive them.
+ * Alignments above the heap's Align are not supported (std::bad_alloc).
+ */
+#ifndef __MM_STL_HPP_
+#define __MM_STL_HPP_
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+#include "mm.hpp"
+
+namespace mm
+{
+
+template <class T, class Heap = heap<>>
+class allocator
+{
+public:
+    using value_type = T;
+
+    explicit allocator(Heap &h) noexcept : h(&h) {}
+    template <class U>
+    allocator(const allocator<U, Heap> &other) noexcept : h(other.h) {}
+
+    T *allocate(std::size_t n)
+    {
+        if (alignof(T) > Heap::alignment || n > std::size_t(-1) / sizeof(T))
+            throw std::bad_alloc();
+        void *p = h->malloc(n * sizeof(T));
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        h->free(p, n * sizeof(T));
+    }
+
+    template <class U>
+    bool operator==(const allocator<U, Heap> &other) const noexcept { return h == other.h; }
+    template <class U>
+    bool operator!=(const allocator<U, Heap> &other) const noexcept { return h != other.h; }
+
+private:
+    template <class U, class H>
+    friend class allocator;
+
+    Heap *h;
+};
+
+template <class Heap = heap<>>
+class heap_resource : public std::pmr::memory_resource
+{
+public:
+    explicit heap_resource(Heap &h) noexcept : h(h) {}
+
+private:
+    Heap &h;
+
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        if (align > Heap::alignment)
+            throw std::bad_alloc();
+        void *p = h.malloc(bytes ? bytes : 1);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t) override
+    {
+        h.free(p, bytes ? bytes : 1);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+/*
+ * pool_resource - requests of up to MaxPooled bytes are rounded up to a
+ * multiple of Heap::alignment (their class). Freed blocks are pushed on
+ * their class's cache and reused LIFO without touching the heap's free
+ * lists; release() (and the destructor) return all cached blocks.
+ */
+template <class Heap = heap<>, std::size_t MaxPooled = 512>
+class pool_resource : public std::pmr::memory_resource
+{
+    static constexpr std::size_t num_classes = MaxPooled / Heap::alignment;
+
+public:
+    explicit pool_resource(Heap &h) noexcept : h(h), caches{} {}
+    pool_resource(const pool_resource &) = delete;
+    pool_resource &operator=(const pool_resource &) = delete;
+    ~pool_resource() override { release(); }
+
+    /* give every cached block back to the heap */
+    void release() noexcept
+    {
+        for (std::size_t c = 0; c < num_classes; c++)
+        {
+            while (caches[c] != nullptr)
+            {
+                node *n = caches[c];
+                caches[c] = n->next;
+                h.free(n);
+            }
+        }
+    }
+
+private:
+    struct node
+    {
+        node *next;
+    };
+
+    Heap &h;
+    node *caches[num_classes];
+
+    static std::size_t class_of(std::size_t bytes)
+    {
+        return (bytes + Heap::alignment - 1) / Heap::alignment - 1;
+    }
+
+    void *do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        if (align > Heap::alignment)
+            throw std::bad_alloc();
+        if (bytes < sizeof(node))
+            bytes = sizeof(node);
+        if (bytes <= MaxPooled)
+        {
+            std::size_t c = class_of(bytes);
+            if (caches[c] != nullptr)
+            {
+                node *n = caches[c];
+                caches[c] = n->next;
+                return n;
+            }
+            bytes = (c + 1) * Heap::alignment;
+        }
+        void *p = h.malloc(bytes);
+        if (p == nullptr)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t) override
+    {
+        if (bytes < sizeof(node))
+            bytes = sizeof(node);
+        if (bytes <= MaxPooled)
+        {
+            node *n = static_cast<node *>(p);
+            std::size_t c = class_of(bytes);
+            n->next = caches[c];
+            caches[c] = n;
+            return;
+        }
+        h.free(p, bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+} // namespace mm
+
+#endif /* __MM_STL_HPP_ */
@@ -0,0 +1,258 @@
+/*
+ * mtbench.c - multithreaded scaling benchmark for mm.c
+ *
+ * Links against mm.c built with -DMM_THREADS. For 1, 2, ..., N threads,
+ * every thread repeatedly allocates a window of small blocks of random
+ * sizes and frees them again, and the benchmark reports the total rate
+ * in Mops/sec (one malloc or free is one op) and the speedup over one
+ * thread. Every thread does the same number of ops, so perfect scaling
+ * keeps the wall time constant.
+ *
+ * Every block is filled with a pattern made from its owner thread and a
+ * sequence number, and the pattern is checked before the block is freed,
+ * so a block handed out twice or overwritten by the allocator makes the
+ * benchmark fail.
+ *
+ * With -x, every window is handed to the next thread (in a ring) and
+ * freed there, so all frees are cross-thread frees. With -v, the lock
+ * contention report of every run is printed (make mtbench-lockprof).
+ *
+ * make mtbench builds it with the lock-free small-block stacks,
+ * make mtbench-locked with every call going through the global lock and
+ * make mtbench-sharded with the per-thread pages.
+ *
+ * usage: mtbench [-x] [-v] [-t <max threads>] [-n <ops per thread>]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+#define WINDOW 64       /* blocks each thread holds at a time */
+#define MAX_SIZE 120    /* largest request size */
+#define MAX_THREADS 256
+
+/* The blocks a thread holds at a time */
+typedef struct
+{
+    void *blocks[WINDOW];
+    size_t sizes[WINDOW];
+    unsigned long tags[WINDOW]; /* owner thread << 32 | sequence number */
+} window_t;
+
+/* A window handed from one thread to the next (-x) */
+typedef struct
+{
+    int full; /* set by the sender, cleared by the receiver */
+    window_t win;
+} mailbox_t;
+
+/* Per-thread arguments */
+typedef struct
+{
+    int id;
+    unsigned long seq; /* blocks allocated so far */
+    unsigned long seed;
+    long iters;       /* windows to allocate and free */
+    mailbox_t *inbox; /* windows to free (-x) */
+    mailbox_t *outbox;
+} worker_t;
+
+static int cross;   /* -x */
+static int verbose; /* -v */
+
+/*
+ * alloc_window - fill win with WINDOW small blocks of random sizes. Each
+ *    block starts with its tag and the rest is filled with the tag's low
+ *    byte.
+ */
+static void alloc_window(window_t *win, worker_t *w, unsigned long *x)
+{
+    for (int i = 0; i < WINDOW; i++)
+    {
+        /* xorshift64 */
+        *x ^= *x << 13;
+        *x ^= *x >> 7;
+        *x ^= *x << 17;
+        size_t size = 8 + *x % (MAX_SIZE - 7);
+        unsigned long tag = (unsigned long)w->id << 32 | (w->seq++ & 0xffffffffUL);
+        if ((win->blocks[i] = mm_malloc(size)) == NULL)
+        {
+            fprintf(stderr, "mtbench: mm_malloc(%zu) failed\n", size);
+            exit(1);
+        }
+        memcpy(win->blocks[i], &tag, sizeof(tag));
+        memset((char *)win->blocks[i] + sizeof(tag), tag & 0xff, size - sizeof(tag));
+        win->sizes[i] = size;
+        win->tags[i] = tag;
+    }
+}
+
+/* free_window - check the pattern of every block in win and free it */
+static void free_window(window_t *win)
+{
+    for (int i = 0; i < WINDOW; i++)
+    {
+        unsigned char *p = win->blocks[i];
+        unsigned long tag;
+        size_t j;
+
+        memcpy(&tag, p, sizeof(tag));
+        for (j = sizeof(tag); j < win->sizes[i] && p[j] == (win->tags[i] & 0xff); j++)
+            ;
+        if (tag != win->tags[i] || j < win->sizes[i])
+        {
+            fprintf(stderr, "mtbench: block %p (%zu bytes) of thread %lu, seq %lu was corrupted\n",
+                    (void *)p, win->sizes[i], win->tags[i] >> 32, win->tags[i] & 0xffffffffUL);
+            exit(1);
+        }
+        mm_free(p);
+    }
+}
+
+/* drain - free the window in the inbox, if any; returns 1 if there was one */
+static int drain(mailbox_t *inbox)
+{
+    if (!__atomic_load_n(&inbox->full, __ATOMIC_ACQUIRE))
+        return 0;
+    free_window(&inbox->win);
+    __atomic_store_n(&inbox->full, 0, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void *worker(void *arg)
+{
+    worker_t *w = arg;
+    unsigned long x = w->seed;
+    window_t win;
+
+    if (!cross)
+    {
+        for (long it = 0; it < w->iters; it++)
+        {
+            alloc_window(&win, w, &x);
+            free_window(&win);
+        }
+        return NULL;
+    }
+
+    /* every thread sends iters windows and receives iters windows */
+    long sent = 0, received = 0;
+    while (sent < w->iters || received < w->iters)
+    {
+        if (sent < w->iters)
+        {
+            alloc_window(&win, w, &x);
+            /* keep freeing what arrives while waiting for the outbox */
+            while (__atomic_load_n(&w->outbox->full, __ATOMIC_ACQUIRE))
+            {
+                if (drain(w->inbox))
+                    received++;
+                else
+                    sched_yield();
+            }
+            w->outbox->win = win;
+            __atomic_store_n(&w->outbox->full, 1, __ATOMIC_RELEASE);
+            sent++;
+        }
+        if (drain(w->inbox))
+            received++;
+        else if (sent == w->iters)
+            sched_yield();
+    }
+    return NULL;
+}
+
+/* run - time nthreads workers on a fresh heap, returns seconds */
+static double run(int nthreads, long ops)
+{
+    pthread_t tids[MAX_THREADS];
+    worker_t args[MAX_THREADS];
+    static mailbox_t mailboxes[MAX_THREADS];
+    struct timespec t0, t1;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+    {
+        fprintf(stderr, "mtbench: mm_init failed\n");
+        exit(1);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < nthreads; i++)
+    {
+        args[i].id = i;
+        args[i].seq = 0;
+        args[i].seed = 0x9e3779b97f4a7c15UL * (i + 1);
+        args[i].iters = ops / (2 * WINDOW);
+        args[i].inbox = &mailboxes[i];
+        args[i].outbox = &mailboxes[(i + 1) % nthreads];
+        if (pthread_create(&tids[i], NULL, worker, &args[i]) != 0)
+        {
+            fprintf(stderr, "mtbench: pthread_create failed\n");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    int maxthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    long ops = 2000000;
+    double base = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "xvt:n:")) != EOF)
+    {
+        switch (c)
+        {
+        case 'x':
+            cross = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        case 't':
+            maxthreads = atoi(optarg);
+            break;
+        case 'n':
+            ops = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-x] [-v] [-t <max threads>] [-n <ops per thread>]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (maxthreads < 1)
+        maxthreads = 1;
+    if (maxthreads > MAX_THREADS)
+        maxthreads = MAX_THREADS;
+    if (ops < 2 * WINDOW)
+        ops = 2 * WINDOW;
+
+    mem_init();
+
+    printf("%8s%12s%10s%10s\n", "threads", "secs", "Mops", "speedup");
+    for (int t = 1; t <= maxthreads; t++)
+    {
+        double secs = run(t, ops);
+        double mops = (double)t * (ops / (2 * WINDOW)) * 2 * WINDOW / secs / 1e6;
+        if (t == 1)
+            base = mops;
+        printf("%8d%12.4f%10.2f%10.2f\n", t, secs, mops, mops / base);
+        if (verbose)
+            mm_lock_report(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * stlbench.cc - container workloads on the system allocator vs. mm
+ *
+ * Runs the same vector / map / unordered_map workloads with
+ *   std      std::allocator (glibc malloc)
+ *   mm       mm::allocator over an mm::heap
+ *   pmr      std::pmr containers over mm::heap_resource
+ *   pool     std::pmr containers over mm::pool_resource
+ * and prints the best of several runs for each in milliseconds.
+ *
+ * usage: stlbench [-n <elements>] [-r <runs>]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "mm_stl.hpp"
+
+using heap_t = mm::heap<>;
+
+static heap_t heap;
+static long sink; /* keeps the workloads from being optimized away */
+
+/* vector: repeated push_back growth, then a sweep */
+template <class Vec>
+static void vector_work(Vec &v, int n)
+{
+    for (int round = 0; round < 8; round++)
+    {
+        v.clear();
+        v.shrink_to_fit();
+        for (int i = 0; i < n; i++)
+            v.push_back(i ^ round);
+        for (int x : v)
+            sink += x;
+    }
+}
+
+/* map: node-per-element insert, lookup, erase of half, reinsert */
+template <class Map>
+static void map_work(Map &m, int n)
+{
+    for (int i = 0; i < n; i++)
+        m[(i * 7919) % n] = i;
+    for (int i = 0; i < n; i++)
+        sink += m.count(i);
+    for (int i = 0; i < n; i += 2)
+        m.erase(i);
+    for (int i = 0; i < n; i += 2)
+        m[i] = -i;
+    m.clear();
+}
+
+template <class T>
+using mm_vector = std::vector<T, mm::allocator<T, heap_t>>;
+template <class K, class V>
+using mm_map = std::map<K, V, std::less<K>, mm::allocator<std::pair<const K, V>, heap_t>>;
+template <class K, class V>
+using mm_umap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                                   mm::allocator<std::pair<const K, V>, heap_t>>;
+
+/* best-of-runs wall time of f() in ms; the mm heap is reset before each run */
+static double best_ms(int runs, const std::function<void()> &f)
+{
+    double best = 0;
+    for (int r = 0; r < runs; r++)
+    {
+        mem_reset_brk();
+        if (heap.init() < 0)
+        {
+            fprintf(stderr, "stlbench: heap init failed\n");
+            exit(1);
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        if (r == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 50000, runs = 5;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:r:")) != EOF)
+    {
+        switch (c)
+        {
+        case 'n':
+            n = atoi(optarg);
+            break;
+        case 'r':
+            runs = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n <elements>] [-r <runs>]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (n <= 0 || runs <= 0)
+    {
+        fprintf(stderr, "stlbench: -n and -r must be positive\n");
+        exit(1);
+    }
+
+    mem_init();
+
+    mm::allocator<int, heap_t> a(heap);
+    mm::heap_resource<heap_t> hres(heap);
+
+    printf("%-14s%10s%10s%10s%10s\n", "workload", "std", "mm", "pmr", "pool");
+
+    double t[4];
+    t[0] = best_ms(runs, [&] { std::vector<int> v; vector_work(v, n); });
+    t[1] = best_ms(runs, [&] { mm_vector<int> v(a); vector_work(v, n); });
+    t[2] = best_ms(runs, [&] { std::pmr::vector<int> v(&hres); vector_work(v, n); });
+    t[3] = best_ms(runs, [&] {
+        mm::pool_resource<heap_t> pool(heap);
+        std::pmr::vector<int> v(&pool);
+        vector_work(v, n);
+    });
+    printf("%-14s%10.2f%10.2f%10.2f%10.2f\n", "vector", t[0], t[1], t[2], t[3]);
+
+    t[0] = best_ms(runs, [&] { std::map<int, int> m; map_work(m, n); });
+    t[1] = best_ms(runs, [&] { mm_map<int, int> m(a); map_work(m, n); });
+    t[2] = best_ms(runs, [&] { std::pmr::map<int, int> m(&hres); map_work(m, n); });
+    t[3] = best_ms(runs, [&] {
+        mm::pool_resource<heap_t> pool(heap);
+        std::pmr::map<int, int> m(&pool);
+        map_work(m, n);
+    });
+    printf("%-14s%10.2f%10.2f%10.2f%10.2f\n", "map", t[0], t[1], t[2], t[3]);
+
+    t[0] = best_ms(runs, [&] { std::unordered_map<int, int> m; map_work(m, n); });
+    t[1] = best_ms(runs, [&] { mm_umap<int, int> m(a); map_work(m, n); });
+    t[2] = best_ms(runs, [&] { std::pmr::unordered_map<int, int> m(&hres); map_work(m, n); });
+    t[3] = best_ms(runs, [&] {
+        mm::pool_resource<heap_t> pool(heap);
+        std::pmr::unordered_map<int, int> m(&pool);
+        map_work(m, n);
+    });
+    printf("%-14s%10.2f%10.2f%10.2f%10.2f\n", "unordered_map", t[0], t[1], t[2], t[3]);
+
+    printf("(ms, best of %d runs, %d elements; sink %ld)\n", runs, n, sink);
+    return 0;
+}